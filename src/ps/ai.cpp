@@ -1,66 +1,845 @@
 #include "ai.hpp"
+#include "engine/montecarlotree.hpp"
+
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
 
 namespace ps {
 
 const int infinity = 1000000;
 
-AI::AI(int timestamp, const Board& board)
-	: player(board.currentPlayer())
-	, timestamp(timestamp)
-	, startingBoard(board)
+/**
+ * Parameters of the GoalDistance evaluation.
+ */
+const int goalDistanceLimit = 3;
+const int distanceWeight = 64;
+const int mobilityWeight = 2;
+const int maxMobility = 16;
+
+/**
+ * Moves are ordered by collectMoves only in nodes of at least this depth.
+ */
+const int minOrderingDepth = 2;
+
+/**
+ * Weights of the history are kept below this, so that adding to them can't overflow.
+ */
+const quint32 historyLimit = 1 << 30;
+
+/**
+ * Half of the width of the aspiration window, for each evaluation: 
+ * about the difference between the values of consecutive iterations.
+ */
+const int aspirationWindow[] = {1, distanceWeight / 2};
+
+namespace {
+
+/**
+ * Identifies a move by the steps after the first @a from ones.
+ */
+quint64 moveKey(Move move, int from)
+{
+	quint64 key = 0;
+	for (int i = from; i < move.size(); i++) {
+		key = key * 9 + move[i] + 1;
+	}
+	return key;
+}
+
+/**
+ * The index of a point in ThreadData::history.
+ */
+int historyIndex(QPoint point)
+{
+	return (point.x() + Board::maxSize / 2) + (point.y() + Board::maxSize / 2 + 1) * (Board::maxSize + 1);
+}
+
+/**
+ * Runs a function in a thread pool.
+ */
+class Task : public QRunnable
+{
+public:
+	explicit Task(std::function<void ()> f)
+		: f(f)
+	{
+	}
+
+	void run() override
+	{
+		f();
+	}
+
+private:
+	std::function<void ()> f;
+};
+
+} // namespace
+
+struct AI::Root
+{
+	Root(Board& board, int depth, int alfa, int beta);
+
+	/**
+	 * The board the moves are made from, searching copies it for every move.
+	 */
+	Board& board;
+
+	/**
+	 * The moves, the index of a move in enumeration order and the number of steps it adds.
+	 */
+	QVector<QVector<Direction>> moves;
+	QVector<int> indices;
+	QVector<int> stepsAdded;
+	int depth;
+
+	/**
+	 * The next move to search.
+	 */
+	std::atomic<int> next;
+
+	/**
+	 * The best value so far, also available without locking as a bound for the threads.
+	 * The search stops when it reaches beta.
+	 */
+	std::atomic<int> alfa;
+	int beta;
+	QMutex mutex;
+	int bestValue;
+	int bestMove;
+};
+
+AI::Root::Root(Board& board, int depth, int alfa, int beta)
+	: board(board)
+	, depth(depth)
+	, next(0)
+	, alfa(alfa)
+	, beta(beta)
+	, bestValue(- 2 * infinity)
+	, bestMove(-1)
+{
+}
+
+AI::AI()
+	: player(Player::One)
+	, completedDepth(0)
+	, stopped(false)
+	, nodeLimit(0)
+	, limitedNodes(0)
+	, table(0)
+	, tableEvaluation(AIConfig::Evaluation::BallRow)
+	, treeMemory(0)
+	, reusedPlayouts_(0)
+	, random(std::random_device()())
 {
+	// The helper threads are started once and wait for the next search.
+	pool.setExpiryTimeout(-1);
 }
 
-void AI::run()
+AI::~AI()
+{
+}
+
+Maybe<Board> AI::search(const Board& board, const AIConfig& config, const CancellationToken& token)
+{
+	player = board.currentPlayer();
+	startingBoard = board;
+	this->config = config;
+	this->token = token;
+	completedDepth = 0;
+	stopped = false;
+	limitedNodes = 0;
+	reusedPlayouts_ = 0;
+	resetThreads();
+	pool.setMaxThreadCount(qMax(1, config.threadCount() - 1));
+	timer.start();
+
+	// Positions solved by the tablebase or in the opening book don't need the engines.
+	Maybe<QVector<Direction>> bestMove = searchTablebase();
+	if (bestMove.isNone() && config.useBook()) {
+		bestMove = searchBook();
+	}
+	if (bestMove.isNone() && config.engine() == AIConfig::Engine::MonteCarlo) {
+		bestMove = searchMonteCarlo();
+	} else if (bestMove.isNone()) {
+		// The Monte Carlo tree uses the memory of the table, so the table is kept
+		// only for the alpha-beta engines, and the tree only for the Monte Carlo engine.
+		tree.reset();
+		table.resize(size_t(config.tableSize()) << 20);
+		if (config.evaluation() != tableEvaluation) {
+			// Values of different evaluations are not comparable.
+			table.clear();
+			tableEvaluation = config.evaluation();
+		}
+		table.newSearch();
+		bestMove = searchAlphaBeta();
+	}
+
+	if (bestMove.isNone()) {
+		return none;
+	}
+
+	Board result = startingBoard;
+	result.setCurrentMove(bestMove.get());
+	return result;
+}
+
+void AI::resetThreads()
+{
+	threads.resize(config.threadCount());
+	for (ThreadData& thread : threads) {
+		thread.nodes = 0;
+		thread.probes = 0;
+		thread.hits = 0;
+		thread.reusedHits = 0;
+		thread.moves.reserve(1024);
+		thread.steps.reserve(4096);
+		std::memset(thread.killers, 0, sizeof(thread.killers));
+		for (quint32* history : thread.history) {
+			for (int i = 0; i < historySize; i++) {
+				history[i] /= 2;
+			}
+		}
+	}
+}
+
+Maybe<QVector<Direction>> AI::searchTablebase()
+{
+	// The tablebase keeps positions at the start of a turn, its value is wrong in the middle of one.
+	if (!startingBoard.currentMove().empty()) {
+		return none;
+	}
+
+	// Board::size() counts the rows of the gates.
+	QSize size(startingBoard.size().width(), startingBoard.size().height() - 2);
+	if (size != tablebaseSize) {
+		tablebaseSize = size;
+		// Without a tablebase for the size, it stays closed and probes find nothing.
+		tablebase.open(Tablebase::fileName(tablebaseSize));
+	}
+
+	Maybe<bool> won = tablebase.probe(startingBoard);
+	if (won.isNone() || !won.get()) {
+		return none;
+	}
+
+	// The position is won, so some move wins the game or leaves the opponent in a lost position.
+	Maybe<QVector<Direction>> winning{none};
+	ThreadData& thread = threads[0];
+	Board board = startingBoard;
+	board.enumerateMoves([&] (Board& child, Move move) {
+		thread.nodes++;
+		Maybe<Player> winner = child.winner();
+		Maybe<bool> childWon = tablebase.probe(child);
+		if ((winner.isSome() && winner.get() == player)
+			|| (winner.isNone() && childWon.isSome() && !childWon.get())) {
+			winning = move.toVector();
+			return false;
+		}
+		return true;
+	});
+	return winning;
+}
+
+Maybe<QVector<Direction>> AI::searchBook()
+{
+	if (config.bookPath() != bookPath) {
+		bookPath = config.bookPath();
+		book.open(bookPath);
+	}
+
+	Maybe<Move> move = book.choose(startingBoard, random());
+	if (move.isNone()) {
+		return none;
+	}
+
+	// A different position with the same hash could have a book move which is not legal here.
+	Board board = startingBoard;
+	for (Direction dir : move.get()) {
+		if (board.winner().isSome() || board.canFinishMove() || !board.canStepInDirection(dir)) {
+			return none;
+		}
+		board.pushStep(dir);
+	}
+	if (board.winner().isNone() && !board.canFinishMove()) {
+		return none;
+	}
+	return move.get().toVector();
+}
+
+const int AI::winValue = infinity;
+
+void AI::setProgress(std::function<void (const Progress&)> progress)
+{
+	this->progress = progress;
+}
+
+void AI::setNodeLimit(quint64 limit)
+{
+	nodeLimit = limit;
+}
+
+quint64 AI::nodeCount() const
+{
+	quint64 count = 0;
+	for (const ThreadData& thread : threads) {
+		count += thread.nodes;
+	}
+	return count;
+}
+
+int AI::reachedDepth() const
+{
+	return completedDepth;
+}
+
+quint64 AI::tableProbes() const
+{
+	quint64 count = 0;
+	for (const ThreadData& thread : threads) {
+		count += thread.probes;
+	}
+	return count;
+}
+
+quint64 AI::tableHits() const
+{
+	quint64 count = 0;
+	for (const ThreadData& thread : threads) {
+		count += thread.hits;
+	}
+	return count;
+}
+
+quint64 AI::reusedTableHits() const
+{
+	quint64 count = 0;
+	for (const ThreadData& thread : threads) {
+		count += thread.reusedHits;
+	}
+	return count;
+}
+
+quint64 AI::reusedPlayouts() const
+{
+	return reusedPlayouts_;
+}
+
+template <typename F>
+bool AI::forFirstMove(Board& board, int& firstMove, int depth, F f)
+{
+	if (firstMove < 0) {
+		return true;
+	}
+
+	int stepsBefore = board.currentMove().size();
+	int index = 0;
+	bool cont = true;
+	board.enumerateMoves([&] (Board& child, Move move) {
+		if (index == firstMove) {
+			cont = f(child, move, firstMove);
+			return false;
+		}
+		index++;
+		// The move is after the one using up the depth, so it's not searched at all.
+		if (depth - (move.size() - stepsBefore) < 0) {
+			firstMove = -1;
+			return false;
+		}
+		return true;
+	});
+	return cont;
+}
+
+template <typename F>
+void AI::forEachMove(Board& board, int firstMove, int depth, F f)
+{
+	if (!forFirstMove(board, firstMove, depth, f)) {
+		return;
+	}
+
+	int stepsBefore = board.currentMove().size();
+	int index = 0;
+	board.enumerateMoves([&] (Board& child, Move move) {
+		int i = index++;
+		if (i != firstMove && !f(child, move, i)) {
+			return false;
+		}
+		return depth - (move.size() - stepsBefore) >= 0;
+	});
+}
+
+QVector<int> AI::searchOrder(Board& board, int depth, int hashMove)
+{
+	QVector<int> indices;
+	if (depth < minOrderingDepth) {
+		forEachMove(board, hashMove, depth, [&] (Board&, Move, int index) {
+			indices.append(index);
+			return true;
+		});
+	} else {
+		std::unique_ptr<ThreadData> thread(new ThreadData);
+		forFirstMove(board, hashMove, depth, [&] (Board&, Move, int index) {
+			indices.append(index);
+			return true;
+		});
+		collectMoves(*thread, board, depth, 0, hashMove);
+		for (const OrderedMove& move : thread->moves) {
+			indices.append(move.index);
+		}
+	}
+	return indices;
+}
+
+Maybe<QVector<Direction>> AI::searchAlphaBeta()
 {
 	Maybe<QVector<Direction>> bestMove{none};
-	int bestValue = - 2 * infinity;
+	if (config.engine() == AIConfig::Engine::LazySmp) {
+		for (int i = 1; i < threads.size(); i++) {
+			ThreadData* thread = &threads[i];
+			Board board = startingBoard;
+			pool.start(new Task([this, thread, board, i] () mutable {
+				searchAsHelper(*thread, board, i);
+			}));
+		}
+	}
+
+	int value = 0;
+	for (int depth = 1; depth <= config.depthLimit(); depth++) {
+		// The value rarely changes much between iterations, a narrow window around the previous
+		// one cuts more. If the value falls outside, the window is opened on that side.
+		int alfa = -infinity;
+		int beta = infinity;
+		if (config.aspirationWindows() && depth > 1 && qAbs(value) < infinity) {
+			int window = aspirationWindow[static_cast<int>(config.evaluation())];
+			alfa = value - window;
+			beta = value + window;
+		}
+
+		Maybe<QVector<Direction>> move = searchRoot(depth, alfa, beta, value);
+		while (move.isSome() && ((value <= alfa && alfa > -infinity) || (value >= beta && beta < infinity))) {
+			if (value <= alfa) {
+				alfa = -infinity;
+			} else {
+				beta = infinity;
+			}
+			move = searchRoot(depth, alfa, beta, value);
+		}
+		if (move.isNone()) {
+			break;
+		}
+		bestMove = move;
+		completedDepth = depth;
+		if (progress) {
+			progress({depth, value, nodeCount(), timer.elapsed(), principalVariation(move.get(), depth)});
+		}
+
+		// A won or lost position won't change with more depth, and the next iteration would take
+		// longer than all previous ones together, so it's not worth starting one without time for it.
+		if (qAbs(value) >= infinity || timer.elapsed() >= config.timeLimit() / 2
+			|| (nodeLimit != 0 && limitedNodes >= nodeLimit)) {
+			break;
+		}
+	}
+
+	// Stop the helpers, if there are any.
+	stopped = true;
+	pool.waitForDone();
+	return bestMove;
+}
+
+Maybe<QVector<Direction>> AI::searchMonteCarlo()
+{
+	// The tree gets the memory the table would have. The previous tree is kept if it contains 
+	// the starting board, after the move it was searched for and the opponent's reply.
+	size_t memory = size_t(config.tableSize()) << 20;
+	if (tree == nullptr || treeMemory != memory || !tree->advance(startingBoard, 2)) {
+		tree.reset();
+		tree.reset(new MonteCarloTree(startingBoard, memory));
+		treeMemory = memory;
+	}
+	reusedPlayouts_ = tree->playoutCount();
+	quint64 limit = config.playoutLimit();
+
+	// Expanding a node of a crowded board can take longer than the whole time limit.
+	auto stop = [this] () {
+		return stopped.load(std::memory_order_relaxed) || token.isCancelled()
+			|| timer.elapsed() >= config.timeLimit();
+	};
+	for (int i = 1; i < threads.size(); i++) {
+		pool.start(new Task([this, i, stop] () {
+			MonteCarloTree::Worker worker(*tree, i, stop);
+			while (!stopped.load(std::memory_order_relaxed)) {
+				tree->iterate(worker);
+			}
+		}));
+	}
+
+	// The AI's thread also checks the limits.
+	MonteCarloTree::Worker worker(*tree, 0, stop);
+	for (int i = 0; ; i++) {
+		tree->iterate(worker);
+		if (limit != 0 && tree->playoutCount() >= limit) {
+			break;
+		}
+		if (nodeLimit != 0 && tree->playoutCount() - reusedPlayouts_ >= nodeLimit) {
+			break;
+		}
+		if (i % 256 == 0 && (tree->isSolved() || token.isCancelled() || timer.elapsed() >= config.timeLimit())) {
+			break;
+		}
+	}
+
+	stopped = true;
+	pool.waitForDone();
+
+	threads[0].nodes = tree->playoutCount() - reusedPlayouts_;
+	Maybe<QVector<Direction>> bestMove = tree->bestMove();
+	if (progress && bestMove.isSome()) {
+		progress({0, none, nodeCount(), timer.elapsed(), {bestMove.get()}});
+	}
+	return bestMove;
+}
+
+Maybe<QVector<Direction>> AI::searchRoot(int depth, int alfa, int beta, int& bestValue)
+{
+	Root root(startingBoard, depth, alfa, beta);
+	collectRootMoves(root);
+
+	// The first move is usually the best one of the previous iteration, searching it alone
+	// gives the other threads a good bound.
+	searchRootMove(threads[0], root, 0);
+	root.next = 1;
+
+	// With Lazy SMP the other threads are already busy with their own searches.
+	int helpers = 0;
+	if (config.engine() == AIConfig::Engine::AlphaBeta) {
+		helpers = qMin(threads.size() - 1, root.moves.size() - 2);
+	}
+	for (int i = 1; i <= helpers; i++) {
+		ThreadData* thread = &threads[i];
+		pool.start(new Task([this, thread, &root] () {
+			searchRootMoves(*thread, root);
+		}));
+	}
+	searchRootMoves(threads[0], root);
+	if (helpers > 0) {
+		pool.waitForDone();
+	}
+
+	if (stopped || root.bestMove < 0) {
+		return none;
+	}
+
+	// Outside the window the value is only a bound, the caller searches again.
+	bestValue = root.bestValue;
+	if ((bestValue > alfa || alfa <= -infinity) && (bestValue < beta || beta >= infinity)) {
+		table.store(startingBoard.hash(), depth, TranspositionTable::Exact, tableValue(bestValue), 
+			root.indices[root.bestMove]);
+	}
+	return root.moves[root.bestMove];
+}
+
+QVector<QVector<Direction>> AI::principalVariation(const QVector<Direction>& move, int length)
+{
+	QVector<QVector<Direction>> moves{move};
+	Board board = startingBoard;
+	board.setCurrentMove(move);
+	while (moves.size() < length && board.winner().isNone()) {
+		board.endMove();
+		Maybe<TranspositionTable::Entry> entry = table.probe(board.hash());
+		if (entry.isNone() || entry.get().move == TranspositionTable::noMove) {
+			break;
+		}
+
+		Maybe<QVector<Direction>> next{none};
+		int index = 0;
+		board.enumerateMoves([&] (Board&, Move childMove) {
+			if (index++ == entry.get().move) {
+				next = childMove.toVector();
+				return false;
+			}
+			return true;
+		});
+		if (next.isNone()) {
+			break;
+		}
+		board.setCurrentMove(next.get());
+		moves.append(next.get());
+	}
+	return moves;
+}
+
+void AI::searchAsHelper(ThreadData& thread, Board& board, int id)
+{
+	// Half of the helpers search one step deeper than the main thread, so that they fill 
+	// the table ahead of it.
+	for (int depth = 1 + id % 2; depth <= config.depthLimit() && !stopped; depth++) {
+		Root root(board, depth, -infinity, infinity);
+		collectRootMoves(root);
+		searchRootMoves(thread, root);
+	}
+}
+
+void AI::collectRootMoves(Root& root)
+{
+	int hashMove = -1;
+	Maybe<TranspositionTable::Entry> entry = table.probe(root.board.hash());
+	if (entry.isSome()) {
+		hashMove = entry.get().move;
+	}
+
+	// Collect the moves, up to the first move longer than the depth.
+	int stepsBefore = root.board.currentMove().size();
+	forEachMove(root.board, hashMove, root.depth, [&] (Board&, Move move, int index) {
+		root.moves.append(move.toVector());
+		root.indices.append(index);
+		root.stepsAdded.append(move.size() - stepsBefore);
+		return true;
+	});
+}
+
+void AI::searchRootMoves(ThreadData& thread, Root& root)
+{
+	for (int i = root.next++; i < root.moves.size() && !stopped; i = root.next++) {
+		searchRootMove(thread, root, i);
+	}
+}
+
+void AI::searchRootMove(ThreadData& thread, Root& root, int i)
+{
+	const QVector<Direction>& move = root.moves[i];
+	int stepsAdded = root.stepsAdded[i];
+
+	// Replay the move the same way Board::enumerateMoves makes it.
+	Board child = root.board;
+	for (int step = move.size() - stepsAdded; step < move.size(); step++) {
+		child.pushStep(move[step]);
+	}
+	if (child.winner().isNone()) {
+		child.finishMove();
+	}
+
+	// The value only matters if it is better than the best so far.
+	int depth = root.depth - stepsAdded;
+	int alfa = root.alfa;
+	int value;
+	if (config.principalVariationSearch() && i > 0 && alfa + 1 < root.beta) {
+		value = alphabeta(thread, child, depth, 1, alfa, alfa + 1, false);
+		if (value > alfa) {
+			value = alphabeta(thread, child, depth, 1, root.alfa, root.beta, false);
+		}
+	} else {
+		value = alphabeta(thread, child, depth, 1, alfa, root.beta, false);
+	}
+	if (stopped) {
+		return;
+	}
+
+	QMutexLocker locker(&root.mutex);
+	if (value > root.bestValue) {
+		root.bestValue = value;
+		root.bestMove = i;
+		root.alfa = qMax(value, root.alfa.load());
+	}
+	if (value >= root.beta) {
+		// A cutoff, the other moves can't change the result.
+		root.next = root.moves.size();
+	}
+}
 
-	int depth = 10;
-	int stepsBefore = startingBoard.currentMove().size();
-	startingBoard.enumerateMoves([&] (Board& child, const QVector<Direction>& move) {
-		int stepsAdded = move.size() - stepsBefore;
-		int value = alphabeta(child, depth - stepsAdded, -infinity, infinity, false);
+void AI::collectMoves(ThreadData& thread, Board& board, int depth, int ply, int skippedMove)
+{
+	int movesStart = thread.moves.size();
+	int stepsBefore = board.currentMove().size();
+	Player mover = board.currentPlayer();
+	const quint64* killers = thread.killers[qMin(ply, AIConfig::maxDepth + 1)];
+	const quint32* history = thread.history[static_cast<int>(mover)];
 
-		if (value > bestValue) {
-			bestMove = move;
-			bestValue = value;
+	int index = 0;
+	board.enumerateMoves([&] (Board& child, Move move) {
+		int i = index++;
+		if (i == skippedMove) {
+			return depth - (move.size() - stepsBefore) >= 0;
 		}
 
-		return !isInterruptionRequested() && depth - stepsAdded >= 0;
+		OrderedMove ordered;
+		ordered.key = moveKey(move, stepsBefore);
+		ordered.index = i;
+		ordered.stepsStart = thread.steps.size();
+		ordered.stepCount = move.size() - stepsBefore;
+		ordered.landing = historyIndex(child.ball());
+		for (int step = stepsBefore; step < move.size(); step++) {
+			thread.steps.append(move[step]);
+		}
+
+		// The score consists of (from the highest bits): the result of the game, killer moves, 
+		// the history and the row of the ball from the mover's point of view.
+		Maybe<Player> winner = child.winner();
+		quint64 result = winner.isNone() ? 1 : winner.get() == mover ? 2 : 0;
+		quint64 killer = ordered.key == killers[0] ? 2 : ordered.key == killers[1] ? 1 : 0;
+		int row = mover == Player::One ? -child.ball().y() : child.ball().y();
+		ordered.score = (result << 62) | (killer << 60) | (quint64(history[ordered.landing]) << 8) 
+			| quint64(row + 128);
+		thread.moves.append(ordered);
+
+		// The same moves as forEachMove would search, so that the results don't change.
+		return depth - ordered.stepCount >= 0;
 	});
 
-	if (!isInterruptionRequested() && bestMove.isSome()) {
-		startingBoard.setCurrentMove(bestMove.get());
-		emit resultReady(timestamp, startingBoard);
+	// Equal moves stay in the enumeration order.
+	std::sort(thread.moves.begin() + movesStart, thread.moves.end(), 
+		[] (const OrderedMove& a, const OrderedMove& b) {
+			return a.score > b.score || (a.score == b.score && a.index < b.index);
+		});
+}
+
+void AI::recordCutoff(ThreadData& thread, Player mover, int ply, int depth, quint64 key, int landing)
+{
+	quint64* killers = thread.killers[qMin(ply, AIConfig::maxDepth + 1)];
+	if (killers[0] != key) {
+		killers[1] = killers[0];
+		killers[0] = key;
 	}
+
+	// Deeper cutoffs save more work.
+	quint32& weight = thread.history[static_cast<int>(mover)][landing];
+	weight = qMin(weight + quint32(depth * depth), historyLimit);
 }
 
-int AI::alphabeta(Board& board, int depth, int alfa, int beta, bool maximizing)
+bool AI::shouldStop(ThreadData& thread)
 {
-	if (isInterruptionRequested())
+	// The limits apply only after the first iteration, so that there is some move to return.
+	if (!stopped && (++thread.nodes & 1023) == 0) {
+		bool overNodeLimit = nodeLimit != 0 && (limitedNodes += 1024) >= nodeLimit;
+		if (token.isCancelled()
+			|| (completedDepth > 0 && (overNodeLimit || timer.elapsed() >= config.timeLimit()))) {
+			stopped = true;
+		}
+	}
+	return stopped;
+}
+
+int AI::alphabeta(ThreadData& thread, Board& board, int depth, int ply, int alfa, int beta, 
+	bool maximizing)
+{
+	if (shouldStop(thread))
 		return 0;
 
 	if (depth <= 0 || board.winner().isSome()) {
 		return value(board);
 	}
 
+	// Look the position up in the table, it might have been searched already 
+	// (e.g. reached with a different bounce order).
+	int hashMove = -1;
+	Maybe<TranspositionTable::Entry> entry = table.probe(board.hash());
+	thread.probes++;
+	if (entry.isSome()) {
+		const TranspositionTable::Entry& e = entry.get();
+		thread.hits++;
+		if (e.generation != table.generation()) {
+			thread.reusedHits++;
+		}
+		hashMove = e.move;
+		if (e.depth >= depth) {
+			int stored = tableValue(e.value);
+			if (e.bound == TranspositionTable::Exact) {
+				return qBound(alfa, stored, beta);
+			} else if (e.bound == TranspositionTable::Lower && stored >= beta) {
+				return beta;
+			} else if (e.bound == TranspositionTable::Upper && stored <= alfa) {
+				return alfa;
+			}
+		}
+	}
+
+	int alfaBefore = alfa;
+	int betaBefore = beta;
+	int bestIndex = -1;
 	int stepsBefore = board.currentMove().size();
-	if (maximizing) {
-		board.enumerateMoves([&] (Board& child, const QVector<Direction>& move) {
-			int stepsAdded = move.size() - stepsBefore;
-			alfa = qMax(alfa, alphabeta(child, depth - stepsAdded, alfa, beta, false));
-			return beta > alfa && depth - stepsAdded >= 0;
-		});
-		return alfa;
-	} else {
-		board.enumerateMoves([&] (Board& child, const QVector<Direction>& move) {
-			int stepsAdded = move.size() - stepsBefore;
-			beta = qMin(beta, alphabeta(child, depth - stepsAdded, alfa, beta, true));
-			return beta > alfa && depth - stepsAdded >= 0;
-		});
-		return beta;
+	Player mover = board.currentPlayer();
+
+	// Searches a move, returns whether there was no cutoff. With principal variation search,
+	// the moves after the first one are expected to be worse: a null window proves it cheaply
+	// and the move is searched again with the full window only if it is better.
+	auto searchMove = [&] (Board& child, int index, int stepsAdded, quint64 key, int landing) {
+		int childDepth = depth - stepsAdded;
+		int value;
+		if (config.principalVariationSearch() && bestIndex >= 0 && alfa + 1 < beta) {
+			if (maximizing) {
+				value = alphabeta(thread, child, childDepth, ply + 1, alfa, alfa + 1, false);
+				if (value > alfa) {
+					value = alphabeta(thread, child, childDepth, ply + 1, alfa, beta, false);
+				}
+			} else {
+				value = alphabeta(thread, child, childDepth, ply + 1, beta - 1, beta, true);
+				if (value < beta) {
+					value = alphabeta(thread, child, childDepth, ply + 1, alfa, beta, true);
+				}
+			}
+		} else {
+			value = alphabeta(thread, child, childDepth, ply + 1, alfa, beta, !maximizing);
+		}
+		if (maximizing) {
+			if (value > alfa || bestIndex < 0) {
+				bestIndex = index;
+			}
+			alfa = qMax(alfa, value);
+		} else {
+			if (value < beta || bestIndex < 0) {
+				bestIndex = index;
+			}
+			beta = qMin(beta, value);
+		}
+		if (beta <= alfa) {
+			recordCutoff(thread, mover, ply, depth, key, landing);
+			return false;
+		}
+		return true;
+	};
+
+	// The move from the table is searched first, without generating the others, 
+	// as it often causes a cutoff. The same moves are searched with or without it (see searchOrder).
+	auto searchEnumerated = [&] (Board& child, Move move, int index) {
+		return searchMove(child, index, move.size() - stepsBefore, moveKey(move, stepsBefore), 
+			historyIndex(child.ball()));
+	};
+	if (depth < minOrderingDepth) {
+		// The children are leaves, sorting them would cost more than it saves.
+		forEachMove(board, hashMove, depth, searchEnumerated);
+	} else if (forFirstMove(board, hashMove, depth, searchEnumerated)) {
+		int movesStart = thread.moves.size();
+		int stepsStart = thread.steps.size();
+		collectMoves(thread, board, depth, ply, hashMove);
+		for (int i = movesStart; i < thread.moves.size(); i++) {
+			OrderedMove move = thread.moves[i];
+			int token = board.pushMove(Move(thread.steps.constData() + move.stepsStart, move.stepCount));
+			bool noCutoff = searchMove(board, move.index, move.stepCount, move.key, move.landing);
+			board.popMove(token, move.stepCount);
+			if (!noCutoff) {
+				break;
+			}
+		}
+		thread.moves.resize(movesStart);
+		thread.steps.resize(stepsStart);
+	}
+
+	int result = maximizing ? alfa : beta;
+	if (!stopped) {
+		TranspositionTable::Bound bound = TranspositionTable::Exact;
+		if (result <= alfaBefore) {
+			bound = TranspositionTable::Upper;
+		} else if (result >= betaBefore) {
+			bound = TranspositionTable::Lower;
+		}
+		table.store(board.hash(), depth, bound, tableValue(result), bestIndex);
 	}
+	return result;
 }
 
 int AI::value(const Board& board)
@@ -74,11 +853,26 @@ int AI::value(const Board& board)
 		}
 	}
 
-	if (player == Player::One) {
-		return -board.ball().y();
-	} else {
-		return board.ball().y();
+	int row = player == Player::One ? -board.ball().y() : board.ball().y();
+	if (config.evaluation() == AIConfig::Evaluation::BallRow) {
+		return row;
+	}
+
+	// A goal one move closer outweighs any rows and mobility, the distances are bounded 
+	// so that far from the goals only the row matters (and the evaluation stays cheap).
+	Board::GoalDistances distances = board.goalDistances(goalDistanceLimit);
+	int mine = distances.goal[static_cast<int>(player)];
+	int theirs = distances.goal[static_cast<int>(!player)];
+	int mobility = qMin(distances.reachable, maxMobility);
+	if (board.currentPlayer() != player) {
+		mobility = -mobility;
 	}
+	return distanceWeight * (theirs - mine) + mobilityWeight * mobility + row;
+}
+
+int AI::tableValue(int value) const
+{
+	return player == Player::One ? value : -value;
 }
 
 } // namespace ps
@@ -1,33 +1,350 @@
 #ifndef PS_AI_HPP
 #define PS_AI_HPP
 
-#include <QtCore/QThread>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThreadPool>
 #include "models/board.hpp"
+#include "models/aiconfig.hpp"
+#include "engine/openingbook.hpp"
+#include "engine/tablebase.hpp"
+#include "engine/transpositiontable.hpp"
+#include "cancellationtoken.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
 
 namespace ps
 {
 
-class AI : public QThread
+class MonteCarloTree;
+
+/**
+ * Searches for the best move using the engine selected by config.engine().
+ * 
+ * The alpha-beta engines use iterative deepening: the position is searched to depth 1, 2, ...
+ * until the time limit or the depth limit of the config is reached. Inside the tree the move from 
+ * the transposition table is searched first, the other moves are ordered by collectMoves using 
+ * killer moves and a history of cutoffs. Optionally (see AIConfig) the moves after the first one 
+ * are searched with a null window (principal variation search) and the iterations start with 
+ * an aspiration window around the value of the previous one.
+ * 
+ * The result is the best move of the last completed iteration, it is returned even if the search 
+ * was cancelled (unless not even the first iteration completed).
+ * 
+ * There are two ways of using more threads (config.threadCount()), selected by config.engine():
+ *     - AlphaBeta splits the moves of the starting board between threads: the first move is 
+ *       searched alone to get a bound, the others are taken by the threads one by one,
+ *     - LazySmp runs the whole iterative deepening in helper threads too, they help only 
+ *       by filling the transposition table, which is shared by all threads.
+ * 
+ * The MonteCarlo engine runs playouts in all threads on a shared tree until the time or the
+ * playout limit, the result is the most visited move.
+ * 
+ * An AI can run any number of searches, one at a time. The transposition table and the helper
+ * threads are kept between them, so a search benefits from the results of the previous ones.
+ * The Monte Carlo tree is kept too, the next search continues from the subtree of its position
+ * if the position was reached by the next move or two.
+ * 
+ * Before any engine runs, a board whose size has a tablebase (see TablebaseGenerator) is looked
+ * up in it, a won position is answered instantly with a move keeping the win. Then, if enabled
+ * by the config, the position is looked up in the opening book.
+ */
+class AI
 {
-	Q_OBJECT
 public:
+	AI();
+	~AI();
+
+	/**
+	 * Searches for the best move from @a board, in the calling thread (and the helper threads).
+	 * @returns @a board with the best move as the current move, or none if there are no moves
+	 *          or the search was cancelled before the first iteration completed.
+	 */
+	Maybe<Board> search(const Board& board, const AIConfig& config, 
+		const CancellationToken& token = CancellationToken());
+
+	/**
+	 * Statistics of the last search, valid after it finished: the number of positions searched 
+	 * by all threads (or playouts of the Monte Carlo engine) and the depth of the last
+	 * completed iteration.
+	 */
+	quint64 nodeCount() const;
+	int reachedDepth() const;
+
+	/**
+	 * How much of the previous searches the last search reused: transposition table probes, 
+	 * the probes that found an entry and the hits on entries stored by previous searches. 
+	 * For the Monte Carlo engine, the playouts inherited with the subtree of the starting board.
+	 */
+	quint64 tableProbes() const;
+	quint64 tableHits() const;
+	quint64 reusedTableHits() const;
+	quint64 reusedPlayouts() const;
+
+	/**
+	 * The value of a won position, see Progress::value.
+	 */
+	static const int winValue;
+
+	/**
+	 * Progress of a search, reported after every completed iteration of the alpha-beta engines
+	 * and at the end of a Monte Carlo search.
+	 */
+	struct Progress
+	{
+		/**
+		 * The depth of the completed iteration, 0 for the Monte Carlo engine.
+		 */
+		int depth;
+
+		/**
+		 * The value of the best move for the player on move: winValue if it wins, -winValue 
+		 * if it loses. None for the Monte Carlo engine.
+		 */
+		Maybe<int> value;
+
+		quint64 nodes;
+		qint64 milliseconds;
+
+		/**
+		 * The best move followed by the expected replies, as far as the transposition table
+		 * remembers them.
+		 */
+		QVector<QVector<Direction>> principalVariation;
+	};
+
 	/**
-	 * Creates an AI starting with @a board.
+	 * Sets a function called with the progress of the searches, in the searching thread.
 	 */
-	AI(int timestamp, const Board& board);
+	void setProgress(std::function<void (const Progress&)> progress);
 
-signals:
-	void resultReady(int timestamp, Board board);
+	/**
+	 * Stops the searches after about @a limit positions (or playouts of the Monte Carlo engine),
+	 * 0 for no limit. Like the time limit, it applies only after the first iteration.
+	 */
+	void setNodeLimit(quint64 limit);
 
 protected:
-	void run() override;
+	/**
+	 * A move waiting to be searched in alphabeta, its steps are kept in ThreadData::steps.
+	 */
+	struct OrderedMove
+	{
+		quint64 score;
+		quint64 key;
+		int index;
+		int stepsStart;
+		int stepCount;
+		int landing;
+	};
+
+	/**
+	 * The history is indexed by the player on move and the point where a move ends.
+	 */
+	static const int historySize = (Board::maxSize + 1) * (Board::maxSize + 3);
+
+	/**
+	 * Data of a single search thread, kept between searches.
+	 */
+	struct ThreadData
+	{
+		quint64 nodes = 0;
+		quint64 probes = 0;
+		quint64 hits = 0;
+		quint64 reusedHits = 0;
+
+		/**
+		 * Stacks of the moves waiting to be searched at all plies of the current line.
+		 */
+		QVector<OrderedMove> moves;
+		QVector<Direction> steps;
+
+		/**
+		 * The last two moves that caused a cutoff at every ply, identified by their steps.
+		 */
+		quint64 killers[AIConfig::maxDepth + 2][2] = {};
+
+		/**
+		 * Weights of the cutoffs caused by moves ending on a point, halved by every search.
+		 */
+		quint32 history[2][historySize] = {};
+	};
+
 	int value(const Board& board);
-	int alphabeta(Board& board, int depth, int alfa, int beta, bool maximizing);
+	int alphabeta(ThreadData& thread, Board& board, int depth, int ply, int alfa, int beta, 
+		bool maximizing);
+
+	/**
+	 * The indices of the moves alphabeta searches at a node of @a depth with @a hashMove from 
+	 * the table (or -1), in the order it searches them if there is no cutoff. The moves are 
+	 * the same whatever the hash move is: the moves in the enumeration order up to the first 
+	 * one using up the depth.
+	 */
+	QVector<int> searchOrder(Board& board, int depth, int hashMove);
 
 private:
+	/**
+	 * The moves of the starting board searched in one iteration and the best one found so far.
+	 */
+	struct Root;
+
+	/**
+	 * Prepares the data of config.threadCount() threads for a new search: clears the counters
+	 * and the killer moves and ages the history.
+	 */
+	void resetThreads();
+
+	/**
+	 * Looks the starting board up in the tablebase of its size, opening the tablebase
+	 * from Tablebase::fileName if there is one. It runs in every search, whatever the config,
+	 * since a tablebase exists only if the user generated it. Boards in the middle of a turn
+	 * are not looked up.
+	 * @returns a move keeping a win, or none if the position is not a win in the tablebase.
+	 */
+	Maybe<QVector<Direction>> searchTablebase();
+
+	/**
+	 * Chooses a move of the starting board from the opening book of the config, opening
+	 * the book if it changed.
+	 * @returns none if the position is not in the book.
+	 */
+	Maybe<QVector<Direction>> searchBook();
+
+	/**
+	 * Runs iterative deepening from the starting board.
+	 * @returns the best move of the last completed iteration.
+	 */
+	Maybe<QVector<Direction>> searchAlphaBeta();
+
+	/**
+	 * Runs Monte Carlo tree search from the starting board.
+	 * @returns the most visited move, the first move of a playout if the tree couldn't grow,
+	 *          or none if there are no moves.
+	 */
+	Maybe<QVector<Direction>> searchMonteCarlo();
+
+	/**
+	 * Searches all moves of the starting board to the given depth, with the window 
+	 * (@a alfa, @a beta). If @a bestValue is outside of it, it is only a bound.
+	 * @returns the best move and sets @a bestValue, or none if the search was stopped.
+	 */
+	Maybe<QVector<Direction>> searchRoot(int depth, int alfa, int beta, int& bestValue);
+
+	/**
+	 * The search of a Lazy SMP helper thread, until the main thread stops it.
+	 */
+	void searchAsHelper(ThreadData& thread, Board& board, int id);
+
+	/**
+	 * Follows the best moves stored in the table from the starting board after @a move.
+	 * @returns @a move and the moves after it, at most @a length moves.
+	 */
+	QVector<QVector<Direction>> principalVariation(const QVector<Direction>& move, int length);
+
+	/**
+	 * Fills root.moves with moves of root.board, starting with the one from the table.
+	 */
+	void collectRootMoves(Root& root);
+
+	/**
+	 * Searches moves of the root not taken by other threads, until there are none left.
+	 */
+	void searchRootMoves(ThreadData& thread, Root& root);
+	void searchRootMove(ThreadData& thread, Root& root, int i);
+
+	/**
+	 * Whether the current iteration should be abandoned, because of a cancellation 
+	 * or the time limit. Checks the clock only every few nodes.
+	 */
+	bool shouldStop(ThreadData& thread);
+
+	/**
+	 * Calls f(Board& child, Move move, int index) for the moves in the enumeration order 
+	 * up to the first one adding more than @a depth steps, until f returns false. The move
+	 * at index @a firstMove goes first, if it is one of them.
+	 */
+	template <typename F>
+	void forEachMove(Board& board, int firstMove, int depth, F f);
+
+	/**
+	 * The first part of forEachMove: calls f for the move at index @a firstMove if forEachMove 
+	 * would visit it, otherwise sets @a firstMove to -1.
+	 * @returns false if f returned false.
+	 */
+	template <typename F>
+	bool forFirstMove(Board& board, int& firstMove, int depth, F f);
+
+	/**
+	 * Appends the moves of @a board to thread.moves, except the move at index @a skippedMove, 
+	 * up to the first move longer than @a depth, and sorts them: winning moves first, then 
+	 * the killer moves of the ply, then by the history of the landing point and by the progress 
+	 * toward the goal of the player on move. Losing moves come last.
+	 */
+	void collectMoves(ThreadData& thread, Board& board, int depth, int ply, int skippedMove);
+
+	/**
+	 * Remembers a move that caused a cutoff, as a killer move of the ply and in the history.
+	 */
+	void recordCutoff(ThreadData& thread, Player mover, int ply, int depth, quint64 key, int landing);
+
+	/**
+	 * Converts values between the AI player's point of view and the table's (player one's).
+	 */
+	int tableValue(int value) const;
+
+	// The current search.
 	Player player;
-	int timestamp;
 	Board startingBoard;
+	AIConfig config;
+	CancellationToken token;
+
+	QElapsedTimer timer;
+	std::atomic<int> completedDepth;
+	std::atomic<bool> stopped;
+
+	std::function<void (const Progress&)> progress;
+	quint64 nodeLimit;
+
+	/**
+	 * The positions counted toward the node limit by all threads, in batches.
+	 */
+	std::atomic<quint64> limitedNodes;
+
+	/**
+	 * Kept between searches, it is resized when the config changes.
+	 */
+	TranspositionTable table;
+	AIConfig::Evaluation tableEvaluation;
+
+	/**
+	 * The tree of the last Monte Carlo search, it is dropped by alpha-beta searches.
+	 */
+	std::unique_ptr<MonteCarloTree> tree;
+	size_t treeMemory;
+	quint64 reusedPlayouts_;
+
+	/**
+	 * Threads helping the searching thread, which is the first one in threads.
+	 * Only the searching thread modifies startingBoard.
+	 */
+	QThreadPool pool;
+	QVector<ThreadData> threads;
+
+	/**
+	 * The tablebase of the last board size searched, if it was found.
+	 */
+	Tablebase tablebase;
+	QSize tablebaseSize;
+
+	/**
+	 * The book of the last search which used one, bookPath is its path even if it couldn't 
+	 * be opened. The book moves are chosen with random.
+	 */
+	OpeningBook book;
+	QString bookPath;
+	std::mt19937_64 random;
 };
 
 } // namespace ps
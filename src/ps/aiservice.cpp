@@ -0,0 +1,153 @@
+#include "aiservice.hpp"
+#include "ai.hpp"
+
+#include <QtCore/QThread>
+
+#include <memory>
+
+namespace ps {
+
+class AIService::Worker : public QThread
+{
+public:
+	explicit Worker(AIService* service)
+		: service(service)
+	{
+	}
+
+protected:
+	void run() override
+	{
+		service->work();
+	}
+
+private:
+	AIService* service;
+};
+
+AIService::AIService()
+	: nextId(0)
+	, quitting(false)
+	, worker(new Worker(this))
+{
+	// Board must be registered because it used in a queued connection.
+	qRegisterMetaType<Board>("Board");
+	qRegisterMetaType<Solver::Result>("Solver::Result");
+	connect(this, &AIService::jobDone, this, &AIService::deliver, Qt::QueuedConnection);
+	connect(this, &AIService::solveDone, this, &AIService::deliverSolved, Qt::QueuedConnection);
+	worker->start();
+}
+
+AIService::~AIService()
+{
+	{
+		QMutexLocker locker(&mutex);
+		quitting = true;
+		running.cancel();
+		wakeUp.wakeAll();
+	}
+	worker->wait();
+	delete worker;
+}
+
+CancellationToken AIService::submit(const Board& board, const AIConfig& config, Callback callback)
+{
+	return enqueueSearch(board, config, callback, false);
+}
+
+CancellationToken AIService::submitHint(const Board& board, const AIConfig& config, Callback callback)
+{
+	return enqueueSearch(board, config, callback, true);
+}
+
+CancellationToken AIService::enqueueSearch(const Board& board, const AIConfig& config, Callback callback, bool hint)
+{
+	CancellationToken token;
+	quint64 id = nextId++;
+	callbacks.insert(id, PendingCallback{token, callback, nullptr});
+
+	QMutexLocker locker(&mutex);
+	jobs.enqueue(Job{id, board, config, token, 0, hint});
+	wakeUp.wakeAll();
+	return token;
+}
+
+CancellationToken AIService::solve(const Board& board, size_t memoryLimit, SolveCallback callback)
+{
+	CancellationToken token;
+	quint64 id = nextId++;
+	callbacks.insert(id, PendingCallback{token, nullptr, callback});
+
+	QMutexLocker locker(&mutex);
+	jobs.enqueue(Job{id, board, AIConfig(), token, qMax<size_t>(memoryLimit, 1), false});
+	wakeUp.wakeAll();
+	return token;
+}
+
+void AIService::work()
+{
+	AI ai;
+	// Created by the first hint, most games don't ask for one.
+	std::unique_ptr<AI> hintAI;
+	// Kept like the AIs, so that solving a later position reuses the table.
+	std::unique_ptr<Solver> solver;
+	size_t solverMemory = 0;
+	while (true) {
+		QMutexLocker locker(&mutex);
+		while (jobs.isEmpty() && !quitting) {
+			wakeUp.wait(&mutex);
+		}
+		if (quitting) {
+			return;
+		}
+		Job job = jobs.dequeue();
+		running = job.token;
+		locker.unlock();
+
+		// Cancelled jobs are still reported, so that their callbacks are released.
+		if (job.solverMemory != 0) {
+			Solver::Result result{Solver::Outcome::Unknown, {}, 0};
+			if (!job.token.isCancelled()) {
+				if (solver == nullptr || solverMemory != job.solverMemory) {
+					solver.reset();
+					solver.reset(new Solver(job.solverMemory));
+					solverMemory = job.solverMemory;
+				}
+				result = solver->solve(job.board, job.token);
+			}
+			emit solveDone(job.id, result);
+			continue;
+		}
+
+		Maybe<Board> result{none};
+		if (!job.token.isCancelled()) {
+			if (job.hint && hintAI == nullptr) {
+				hintAI.reset(new AI);
+			}
+			result = (job.hint ? *hintAI : ai).search(job.board, job.config, job.token);
+		}
+		if (result.isSome()) {
+			emit jobDone(job.id, true, result.get());
+		} else {
+			emit jobDone(job.id, false, job.board);
+		}
+	}
+}
+
+void AIService::deliver(quint64 id, bool found, Board boardAfter)
+{
+	PendingCallback pending = callbacks.take(id);
+	if (found && pending.callback && !pending.token.isCancelled()) {
+		pending.callback(boardAfter);
+	}
+}
+
+void AIService::deliverSolved(quint64 id, Solver::Result result)
+{
+	PendingCallback pending = callbacks.take(id);
+	if (pending.solveCallback && !pending.token.isCancelled()) {
+		pending.solveCallback(result);
+	}
+}
+
+} // namespace ps
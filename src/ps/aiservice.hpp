@@ -0,0 +1,134 @@
+#ifndef PS_AISERVICE_HPP
+#define PS_AISERVICE_HPP
+
+#include <QtCore/QObject>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QQueue>
+#include <QtCore/QHash>
+#include "models/board.hpp"
+#include "models/aiconfig.hpp"
+#include "cancellationtoken.hpp"
+#include "solver.hpp"
+
+#include <functional>
+
+namespace ps
+{
+
+/**
+ * Runs AI searches and solver jobs in a single long-lived thread, one after another.
+ * 
+ * The thread and its AI live as long as the service, so the transposition table and the helper 
+ * threads of the AI are kept between moves. Hints get an AI of their own. Results are passed 
+ * to callbacks in the thread the service lives in (the GUI thread).
+ */
+class AIService : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * Receives the board with the best move as the current move (not finished).
+	 */
+	typedef std::function<void (Board boardAfter)> Callback;
+
+	/**
+	 * Receives the result of solving a position.
+	 */
+	typedef std::function<void (Solver::Result result)> SolveCallback;
+
+	AIService();
+	virtual ~AIService();
+
+	/**
+	 * Queues a search from @a board. The callback is called when the search finishes, 
+	 * unless the search was cancelled in the meantime or there was no move. It can be empty
+	 * if only the side effects of the search matter (the state kept in the AI).
+	 * 
+	 * @returns a token cancelling the search, a running search stops as soon as possible.
+	 */
+	CancellationToken submit(const Board& board, const AIConfig& config, Callback callback);
+
+	/**
+	 * Queues a search like submit, but with a separate AI, so that a hint for a human player 
+	 * doesn't resize or clear the table kept for the AI players (e.g. by pondering).
+	 */
+	CancellationToken submitHint(const Board& board, const AIConfig& config, Callback callback);
+
+	/**
+	 * Queues solving @a board with a solver using at most @a memoryLimit bytes. The callback
+	 * is called with the result, unless the job was cancelled in the meantime.
+	 * 
+	 * @returns a token cancelling the job.
+	 */
+	CancellationToken solve(const Board& board, size_t memoryLimit, SolveCallback callback);
+
+signals:
+	/**
+	 * Emitted by the worker thread when a job is done, passes the result to the service's thread.
+	 */
+	void jobDone(quint64 id, bool found, Board boardAfter);
+	void solveDone(quint64 id, Solver::Result result);
+
+private:
+	struct Job
+	{
+		quint64 id;
+		Board board;
+		AIConfig config;
+		CancellationToken token;
+
+		/**
+		 * The memory of the solver for solver jobs, 0 for searches.
+		 */
+		size_t solverMemory;
+
+		/**
+		 * Whether the search uses the AI of hints.
+		 */
+		bool hint;
+	};
+
+	struct PendingCallback
+	{
+		CancellationToken token;
+		Callback callback;
+		SolveCallback solveCallback;
+	};
+
+	class Worker;
+
+	/**
+	 * The loop of the worker thread, runs jobs until the service is destroyed.
+	 */
+	void work();
+
+	/**
+	 * Queues a search, see submit and submitHint.
+	 */
+	CancellationToken enqueueSearch(const Board& board, const AIConfig& config, Callback callback, bool hint);
+
+	/**
+	 * Calls the callback of a finished job.
+	 */
+	void deliver(quint64 id, bool found, Board boardAfter);
+	void deliverSolved(quint64 id, Solver::Result result);
+
+	// Used only in the service's thread.
+	quint64 nextId;
+	QHash<quint64, PendingCallback> callbacks;
+
+	// Shared with the worker thread.
+	QMutex mutex;
+	QWaitCondition wakeUp;
+	QQueue<Job> jobs;
+	CancellationToken running;
+	bool quitting;
+
+	Worker* worker;
+};
+
+} // namespace ps
+
+#endif // PS_AISERVICE_HPP
@@ -7,6 +7,7 @@
 #include "models/recentlysaved.hpp"
 #include "models/gameconfig.hpp"
 #include "models/history.hpp"
+#include "aiservice.hpp"
 #include "controllers/controller.hpp"
 #include "controllers/welcomecontroller.hpp"
 #include "controllers/gameconfigcontroller.hpp"
@@ -31,10 +32,8 @@ Application::Application()
 	, recentlySaved_(new RecentlySaved)
 	, gameConfig_(new GameConfig)
 	, history_(new History)
+	, aiService_(new AIService)
 {
-	// Board must be registered because it used in a queued connection.
-	qRegisterMetaType<Board>("Board");
-
 	// Setup actions.
 	QStyle* style = QApplication::style();
 
@@ -88,6 +87,9 @@ Application::~Application()
 	delete gameConfigController_;
 	delete gameController_;
 
+	// delete services
+	delete aiService_;
+
 	// delete models
 	recentlySaved_->save();
 	delete recentlySaved_;
@@ -183,6 +185,11 @@ History* Application::history()
 	return history_;
 }
 
+AIService* Application::aiService()
+{
+	return aiService_;
+}
+
 void Application::newGame()
 {
 	if (confirm()) {
@@ -20,6 +20,7 @@ class RecentlySaved;
 class History;
 class WelcomeView;
 class WelcomeController;
+class AIService;
 
 class Application : public QObject
 {
@@ -54,6 +55,9 @@ public:
 	GameConfig* gameConfig();
 	History* history();
 
+	// Services
+	AIService* aiService();
+
 	// Actions
 	void newGame();
 	void loadGame();
@@ -90,6 +94,9 @@ private:
 	GameConfig* gameConfig_;
 	History* history_;
 
+	// Services
+	AIService* aiService_;
+
 	// Actions
 	QAction* newGameAction_;
 	QAction* loadGameAction_;
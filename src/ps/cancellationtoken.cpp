@@ -0,0 +1,20 @@
+#include "cancellationtoken.hpp"
+
+namespace ps {
+
+CancellationToken::CancellationToken()
+	: cancelled_(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+void CancellationToken::cancel() const
+{
+	cancelled_->store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::isCancelled() const
+{
+	return cancelled_->load(std::memory_order_relaxed);
+}
+
+} // namespace ps
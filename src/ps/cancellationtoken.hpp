@@ -0,0 +1,33 @@
+#ifndef PS_CANCELLATIONTOKEN_HPP
+#define PS_CANCELLATIONTOKEN_HPP
+
+#include <atomic>
+#include <memory>
+
+namespace ps
+{
+
+/**
+ * A flag telling a long-running job to stop, shared by all copies of the token.
+ * 
+ * The side that started the job keeps a copy to cancel it, the job checks its copy 
+ * from time to time. Both can be used from different threads.
+ */
+class CancellationToken
+{
+public:
+	/**
+	 * Creates a new token, not cancelled.
+	 */
+	CancellationToken();
+
+	void cancel() const;
+	bool isCancelled() const;
+
+private:
+	std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+} // namespace ps
+
+#endif // PS_CANCELLATIONTOKEN_HPP
@@ -8,7 +8,7 @@
 #include "../models/gameconfig.hpp"
 #include "../models/history.hpp"
 #include "../mainwindow.hpp"
-#include "../ai.hpp"
+#include "../aiservice.hpp"
 
 #include <QtWidgets/QMessageBox>
 
@@ -31,7 +31,8 @@ void GameController::setup(Application* app)
 	connect(view->boardView(), &BoardView::pointMouseEnter, this, &GameController::pointMouseEnter);
 	connect(view->boardView(), &BoardView::pointMouseLeave, this, &GameController::pointMouseLeave);
 	connect(view->startHintButton(), &QPushButton::clicked, this, &GameController::startHint);
-	connect(view->stopHintButton(), &QPushButton::clicked, this, &GameController::stopHint);
+	connect(view->stopHintButton(), &QPushButton::clicked, this, &GameController::stopClicked);
+	connect(view->solveButton(), &QPushButton::clicked, this, &GameController::startSolver);
 	connect(view->startAiButton(), &QPushButton::clicked, this, &GameController::aiStart);
 	connect(view->stopAiButton(), &QPushButton::clicked, this, &GameController::aiStop);
 	connect(view->playerSwitch(), &PlayerSwitch::clicked, this, &GameController::endTurn);
@@ -100,18 +101,28 @@ void GameController::updateFocusedBoard(bool updatePlayerSwitch)
 	}
 }
 
-void GameController::safeDeleteAi()
+void GameController::startPondering()
 {
-	// This is a bit tricky:
-	// If the AI is finished then we will just call deleteLater here.
-	// If the AI is not finished we either:
-	//     - call deleteLater after the signal fires
-	//     - call deleteLater after the signal fires AND here, but that's ok.
+	Player opponent = !board()->currentPlayer();
+	if (app->gameConfig()->isPlayerHuman(opponent)) {
+		return;
+	}
 
-	connect(ai, &QThread::finished, ai, &QThread::deleteLater);
-	if (ai->isFinished()) {
-		ai->deleteLater();
+	AIConfig config = app->gameConfig()->aiConfig(opponent);
+	if (!config.ponder()) {
+		return;
 	}
+
+	// Search until cancelled (or until the depth or playout limit), only the transposition 
+	// table or the Monte Carlo tree left in the AI matters.
+	stopPondering();
+	config.setTimeLimit(AIConfig::maxTimeLimit);
+	ponderSearch = app->aiService()->submit(*board(), config, nullptr);
+}
+
+void GameController::stopPondering()
+{
+	ponderSearch.cancel();
 }
 
 void GameController::edit()
@@ -209,6 +220,7 @@ void GameController::disabledToHuman()
 	view->hintBox()->show();
 	view->startHintButton()->setEnabled(true);
 	view->stopHintButton()->setEnabled(false);
+	view->solveButton()->setEnabled(true);
 }
 
 void GameController::disabledToAIStopped()
@@ -275,6 +287,7 @@ void GameController::removeSegment()
 
 	if (state() == HumanFinished && board()->winner().isNone()) {
 		humanFinishedToHuman();
+		startPondering();
 	}
 }
 
@@ -290,19 +303,20 @@ void GameController::startHint()
 	view->playerSwitch()->setEnabled(false);
 	view->startHintButton()->setEnabled(false);
 	view->stopHintButton()->setEnabled(true);
+	view->solveButton()->setEnabled(false);
 	QApplication::setOverrideCursor({Qt::BusyCursor});
+	stopPondering();
 
-	ai = new AI(time(), *board());
-	connect(ai, &AI::resultReady, this, &GameController::hintResultReady, Qt::QueuedConnection);
-	ai->start();
+	int timestamp = time();
+	aiSearch = app->aiService()->submitHint(*board(), app->gameConfig()->aiConfig(board()->currentPlayer()),
+		[this, timestamp] (Board boardAfter) { hintResultReady(timestamp, boardAfter); });
 }
 
 void GameController::hintResultReady(int timestamp, Board board)
 {
-	// It is possible that a late signal arrives e.g. when we cancel 
-	// the hint, but the resultReady signal is already waiting in the queue.
-	// Just ignore signals that dont match the current time.
-	if (timestamp == time()) {
+	// The service doesn't report cancelled searches, but check that the result 
+	// belongs to the current position anyway.
+	if (timestamp == time() && state() == HumanHintRunning) {
 		finishHint(board);
 	}
 }
@@ -314,9 +328,9 @@ void GameController::stopHint()
 	view->playerSwitch()->setEnabled(board()->canFinishMove());
 	view->startHintButton()->setEnabled(true);
 	view->stopHintButton()->setEnabled(false);
+	view->solveButton()->setEnabled(true);
 	QApplication::restoreOverrideCursor();
-	ai->requestInterruption();
-	safeDeleteAi();
+	aiSearch.cancel();
 }
 
 void GameController::finishHint(Board boardAfter)
@@ -325,10 +339,96 @@ void GameController::finishHint(Board boardAfter)
 	setState(Human);
 	view->startHintButton()->setEnabled(true);
 	view->stopHintButton()->setEnabled(false);
+	view->solveButton()->setEnabled(true);
 	QApplication::restoreOverrideCursor();
-	safeDeleteAi();
 	*board() = boardAfter;
 	updateFocusedBoard(true);
+	startPondering();
+}
+
+void GameController::startSolver()
+{
+	Q_ASSERT(state() == Human);
+
+	// A winning move is shown on the board, like a hint.
+	if (!clearFutureHistory()) {
+		return;
+	}
+
+	setState(HumanSolverRunning);
+	view->playerSwitch()->setEnabled(false);
+	view->startHintButton()->setEnabled(false);
+	view->stopHintButton()->setEnabled(true);
+	view->solveButton()->setEnabled(false);
+	QApplication::setOverrideCursor({Qt::BusyCursor});
+	stopPondering();
+
+	// The solver gets the memory of the current player's transposition table.
+	int timestamp = time();
+	size_t memory = size_t(app->gameConfig()->aiConfig(board()->currentPlayer()).tableSize()) << 20;
+	aiSearch = app->aiService()->solve(*board(), memory,
+		[this, timestamp] (Solver::Result result) { solverResultReady(timestamp, result); });
+}
+
+void GameController::solverResultReady(int timestamp, Solver::Result result)
+{
+	if (timestamp == time() && state() == HumanSolverRunning) {
+		finishSolver(result);
+	}
+}
+
+void GameController::stopClicked()
+{
+	if (state() == HumanHintRunning) {
+		stopHint();
+		startPondering();
+	} else if (state() == HumanSolverRunning) {
+		stopSolver();
+		startPondering();
+	}
+}
+
+void GameController::stopSolver()
+{
+	Q_ASSERT(state() == HumanSolverRunning);
+	setState(Human);
+	view->playerSwitch()->setEnabled(board()->canFinishMove());
+	view->startHintButton()->setEnabled(true);
+	view->stopHintButton()->setEnabled(false);
+	view->solveButton()->setEnabled(true);
+	QApplication::restoreOverrideCursor();
+	aiSearch.cancel();
+}
+
+void GameController::finishSolver(Solver::Result result)
+{
+	Q_ASSERT(state() == HumanSolverRunning);
+	setState(Human);
+	view->startHintButton()->setEnabled(true);
+	view->stopHintButton()->setEnabled(false);
+	view->solveButton()->setEnabled(true);
+	QApplication::restoreOverrideCursor();
+
+	QString text;
+	if (result.outcome == Solver::Outcome::Win) {
+		text = tr("The current player can force a win. The first move of the win is shown on the board.");
+		if (!result.move.isEmpty()) {
+			board()->setCurrentMove(result.move);
+		}
+	} else if (result.outcome == Solver::Outcome::Loss) {
+		text = tr("The opponent can force a win, whatever the current player does.");
+	} else {
+		text = tr("The position could not be solved.");
+	}
+	updateFocusedBoard(true);
+	startPondering();
+
+	QMessageBox mbox;
+	mbox.setIcon(QMessageBox::Information);
+	mbox.setWindowTitle(tr("Position solved"));
+	mbox.setText(text);
+	mbox.setInformativeText(tr("%1 positions were searched.").arg(result.nodeCount));
+	mbox.exec();
 }
 
 void GameController::humanToHumanFinished()
@@ -336,6 +436,8 @@ void GameController::humanToHumanFinished()
 	Q_ASSERT(state() == Human);
 	setState(HumanFinished);
 	view->startHintButton()->setEnabled(false);
+	view->solveButton()->setEnabled(false);
+	stopPondering();
 }
 
 void GameController::humanFinishedToHuman()
@@ -343,12 +445,14 @@ void GameController::humanFinishedToHuman()
 	Q_ASSERT(state() == HumanFinished);
 	setState(Human);
 	view->startHintButton()->setEnabled(true);
+	view->solveButton()->setEnabled(true);
 }
 
 void GameController::humanToDisabled()
 {
 	Q_ASSERT(state() == Human);
 	setState(Disabled);
+	stopPondering();
 	view->boardView()->setBoard(nullptr);
 	view->playerSwitch()->setEnabled(false);
 	view->aiBox()->hide();
@@ -369,17 +473,16 @@ void GameController::aiStart()
 	view->stopAiButton()->setEnabled(true);
 	QApplication::setOverrideCursor({Qt::BusyCursor});
 
-	ai = new AI(time(), *board());
-	connect(ai, &AI::resultReady, this, &GameController::aiResultReady, Qt::QueuedConnection);
-	ai->start();
+	int timestamp = time();
+	aiSearch = app->aiService()->submit(*board(), app->gameConfig()->aiConfig(board()->currentPlayer()),
+		[this, timestamp] (Board boardAfter) { aiResultReady(timestamp, boardAfter); });
 }
 
 void GameController::aiResultReady(int timestamp, Board board)
 {
-	// It is possible that a late signal arrives e.g. when we cancel 
-	// the hint, but the resultReady signal is already waiting in the queue.
-	// Just ignore signals that dont match the current time.
-	if (timestamp == time()) {
+	// The service doesn't report cancelled searches, but check that the result 
+	// belongs to the current position anyway.
+	if (timestamp == time() && state() == AIRunning) {
 		aiFinish(board);
 	}
 }
@@ -392,8 +495,7 @@ void GameController::aiStop()
 	view->startAiButton()->setEnabled(true);
 	view->stopAiButton()->setEnabled(false);
 	QApplication::restoreOverrideCursor();
-	ai->requestInterruption();
-	safeDeleteAi();
+	aiSearch.cancel();
 }
 
 void GameController::aiFinish(Board boardAfter)
@@ -403,7 +505,6 @@ void GameController::aiFinish(Board boardAfter)
 	view->startAiButton()->setEnabled(true);
 	view->stopAiButton()->setEnabled(false);
 	QApplication::restoreOverrideCursor();
-	safeDeleteAi();
 
 	*board() = boardAfter;
 	updateFocusedBoard(true);
@@ -443,6 +544,11 @@ void GameController::anyToDisabled()
 			humanToDisabled();
 			break;
 
+		case HumanSolverRunning:
+			stopSolver();
+			humanToDisabled();
+			break;
+
 		case HumanFinished:
 			humanFinishedToHuman();
 			humanToDisabled();
@@ -471,6 +577,8 @@ void GameController::disabledToAppropriate(bool runAi)
 		disabledToHuman();
 		if (board()->winner().isSome()) {
 			humanToHumanFinished();
+		} else {
+			startPondering();
 		}
 	} else {
 		disabledToAIStopped();
@@ -4,11 +4,12 @@
 #include "controller.hpp"
 #include "../models/board.hpp"
 #include "../views/gameview.hpp"
+#include "../cancellationtoken.hpp"
+#include "../solver.hpp"
 
 namespace ps
 {
 
-class AI;
 class Board;
 
 class GameController : public Controller
@@ -29,7 +30,14 @@ private:
 	Board* board();
 	bool clearFutureHistory();
 	void updateFocusedBoard(bool updatePlayerSwitch);
-	void safeDeleteAi();
+
+	/**
+	 * Searches the position in the background while a human plays against the AI, 
+	 * the next AI search reuses the results. Called when the human's turn settles in 
+	 * the Human state, not by transitions which anyToDisabled chains on the way out of it.
+	 */
+	void startPondering();
+	void stopPondering();
 
 	// -------
 	// Signal handlers
@@ -42,6 +50,8 @@ private:
 	void pointMouseLeave(QPoint point);
 	void hintResultReady(int timestamp, Board board);
 	void aiResultReady(int timestamp, Board board);
+	void solverResultReady(int timestamp, Solver::Result result);
+	void stopClicked();
 
 	// ------
 	// States
@@ -51,6 +61,7 @@ private:
 		Human,
 		HumanDraggingBall,
 		HumanHintRunning,
+		HumanSolverRunning,
 		HumanFinished,
 		AIRunning,
 		AIStopped
@@ -90,6 +101,15 @@ private:
 	// HumanHintRunning -> Human
 	void finishHint(Board boardAfter);
 
+	// Human -> {Human, HumanSolverRunning}
+	void startSolver();
+
+	// HumanSolverRunning -> Human
+	void stopSolver();
+
+	// HumanSolverRunning -> Human
+	void finishSolver(Solver::Result result);
+
 	// Human -> HumanFinished
 	void humanToHumanFinished();
 
@@ -127,7 +147,12 @@ private:
 	GameView *view;
 	State state_;
 	int time_;
-	AI* ai;
+
+	/**
+	 * Cancels the running hint, AI search or solver.
+	 */
+	CancellationToken aiSearch;
+	CancellationToken ponderSearch;
 };
 
 } // namespace ps
@@ -0,0 +1,411 @@
+#include "montecarlotree.hpp"
+
+#include <cmath>
+
+namespace ps {
+
+/**
+ * The exploration constant of UCB1.
+ */
+const double exploration = 1.4;
+
+/**
+ * The size of the step arena per node, moves are mostly short.
+ */
+const int stepsPerNode = 4;
+
+const size_t bytesPerNode = 4 * sizeof(int) + sizeof(quint16) + sizeof(quint8)
+	+ 2 * sizeof(std::atomic<quint32>) + stepsPerNode * sizeof(Direction);
+
+MonteCarloTree::Worker::Worker(const MonteCarloTree& tree, int id, std::function<bool ()> stop)
+	: board_(tree.rootBoard_)
+	, randomState_((tree.rootBoard_.hash() ^ 0x9e3779b97f4a7c15) * (2 * id + 1))
+	, stop_(stop)
+{
+	if (randomState_ == 0) {
+		randomState_ = 1;
+	}
+}
+
+MonteCarloTree::MonteCarloTree(const Board& board, size_t memoryLimit)
+	: rootBoard_(board)
+	, nodeCapacity_(qBound<size_t>(1, memoryLimit / bytesPerNode, 1 << 28))
+	, nodeCount_(1)
+	, parent_(new int[nodeCapacity_])
+	, firstChild_(new std::atomic<int>[nodeCapacity_])
+	, childCount_(new int[nodeCapacity_])
+	, stepsStart_(new int[nodeCapacity_])
+	, stepsCount_(new quint16[nodeCapacity_])
+	, state_(new quint8[nodeCapacity_])
+	, visits_(new std::atomic<quint32>[nodeCapacity_])
+	, wins_(new std::atomic<quint32>[nodeCapacity_])
+	, stepCapacity_(nodeCapacity_ * stepsPerNode)
+	, stepCount_(0)
+	, steps_(new Direction[stepCapacity_])
+	, full_(false)
+{
+	parent_[0] = -1;
+	firstChild_[0] = notExpanded;
+	childCount_[0] = 0;
+	stepsStart_[0] = 0;
+	stepsCount_[0] = 0;
+	state_[0] = makeState(!board.currentPlayer(), board.winner());
+	visits_[0] = 0;
+	wins_[0] = 0;
+}
+
+void MonteCarloTree::iterate(Worker& worker)
+{
+	Board& board = worker.board_;
+	board = rootBoard_;
+
+	// Selection.
+	int index = 0;
+	visits_[0].fetch_add(1, std::memory_order_relaxed);
+	while (firstChild_[index].load(std::memory_order_acquire) >= 0) {
+		index = selectChild(index);
+		visits_[index].fetch_add(1, std::memory_order_relaxed);
+		makeMove(index, board);
+	}
+
+	// Expansion, a leaf is expanded on its second visit (the root on the first one).
+	int expected = notExpanded;
+	if (!(state_[index] & Terminal) && !full_.load(std::memory_order_relaxed) &&
+		(index == 0 || visits_[index].load(std::memory_order_relaxed) > 1) &&
+		firstChild_[index].compare_exchange_strong(expected, expanding, std::memory_order_relaxed)
+	) {
+		int first = expand(index, board, worker);
+		if (first >= 0) {
+			firstChild_[index].store(first, std::memory_order_release);
+			index = selectChild(index);
+			visits_[index].fetch_add(1, std::memory_order_relaxed);
+			makeMove(index, board);
+		} else {
+			firstChild_[index].store(notExpanded, std::memory_order_release);
+		}
+	}
+
+	// Playout.
+	Player result = (state_[index] & Terminal) ? winner(state_[index]) : playout(board, worker.randomState_);
+
+	// Backpropagation, the visits were counted on the way down.
+	for (; index >= 0; index = parent_[index]) {
+		if (player(state_[index]) == result) {
+			wins_[index].fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool MonteCarloTree::advance(const Board& board, int maxMoves)
+{
+	int index = findNode(0, rootBoard_, board, maxMoves);
+	if (index < 0) {
+		return false;
+	}
+
+	// Copy the subtree breadth first, so that the children of a node stay next to each other.
+	// A tree of the same capacity has room for it, as it is a part of this tree. The parents 
+	// are set when the children are queued.
+	MonteCarloTree tree(board, nodeCapacity_ * bytesPerNode);
+	QVector<int> nodes{index};
+	int stepCount = 0;
+	for (int i = 0; i < nodes.size(); i++) {
+		int node = nodes[i];
+		tree.childCount_[i] = childCount_[node];
+		tree.stepsStart_[i] = stepCount;
+		tree.stepsCount_[i] = i == 0 ? 0 : stepsCount_[node];
+		tree.state_[i] = state_[node];
+		tree.visits_[i].store(visits_[node].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		tree.wins_[i].store(wins_[node].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		for (int step = 0; step < tree.stepsCount_[i]; step++) {
+			tree.steps_[stepCount++] = steps_[stepsStart_[node] + step];
+		}
+
+		int first = firstChild_[node].load(std::memory_order_relaxed);
+		if (first >= 0) {
+			tree.firstChild_[i].store(nodes.size(), std::memory_order_relaxed);
+			for (int child = first; child < first + childCount_[node]; child++) {
+				tree.parent_[nodes.size()] = i;
+				nodes.append(child);
+			}
+		} else {
+			tree.firstChild_[i].store(notExpanded, std::memory_order_relaxed);
+		}
+	}
+
+	// The search would fill the arenas quickly and stop growing the tree, a new tree is better.
+	if (nodes.size() > nodeCapacity_ / 2 || stepCount > stepCapacity_ / 2) {
+		return false;
+	}
+
+	rootBoard_ = board;
+	nodeCount_.store(nodes.size(), std::memory_order_relaxed);
+	stepCount_.store(stepCount, std::memory_order_relaxed);
+	full_.store(false, std::memory_order_relaxed);
+	parent_.swap(tree.parent_);
+	firstChild_.swap(tree.firstChild_);
+	childCount_.swap(tree.childCount_);
+	stepsStart_.swap(tree.stepsStart_);
+	stepsCount_.swap(tree.stepsCount_);
+	state_.swap(tree.state_);
+	visits_.swap(tree.visits_);
+	wins_.swap(tree.wins_);
+	steps_.swap(tree.steps_);
+	return true;
+}
+
+quint64 MonteCarloTree::playoutCount() const
+{
+	return visits_[0].load(std::memory_order_relaxed);
+}
+
+int MonteCarloTree::nodeCount() const
+{
+	return nodeCount_.load(std::memory_order_relaxed);
+}
+
+size_t MonteCarloTree::memoryUsage() const
+{
+	return nodeCapacity_ * bytesPerNode;
+}
+
+bool MonteCarloTree::isSolved() const
+{
+	if (state_[0] & Terminal) {
+		return true;
+	}
+
+	int first = firstChild_[0].load(std::memory_order_acquire);
+	for (int i = first; i >= 0 && i < first + childCount_[0]; i++) {
+		if ((state_[i] & Terminal) && winner(state_[i]) == player(state_[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+Maybe<QVector<Direction>> MonteCarloTree::bestMove() const
+{
+	int first = firstChild_[0].load(std::memory_order_acquire);
+	int best = -1;
+	for (int i = first; i >= 0 && i < first + childCount_[0]; i++) {
+		if ((state_[i] & Terminal) && winner(state_[i]) == player(state_[i])) {
+			best = i;
+			break;
+		}
+		if (best < 0 || visits_[i] > visits_[best]) {
+			best = i;
+		}
+	}
+
+	if (best < 0 && (state_[0] & Terminal)) {
+		return none;
+	} else if (best < 0) {
+		// The first move of a playout is better than no move at all.
+		Board board = rootBoard_;
+		quint64 randomState = rootBoard_.hash() | 1;
+		randomSteps(board, randomState);
+		return board.currentMove().toVector();
+	}
+
+	QVector<Direction> move = rootBoard_.currentMove().toVector();
+	for (int i = stepsStart_[best]; i < stepsStart_[best] + stepsCount_[best]; i++) {
+		move.append(steps_[i]);
+	}
+	return move;
+}
+
+int MonteCarloTree::reserve(std::atomic<int>& used, int capacity, int count)
+{
+	int start = used.load(std::memory_order_relaxed);
+	do {
+		if (count > capacity - start) {
+			return -1;
+		}
+	} while (!used.compare_exchange_weak(start, start + count, std::memory_order_relaxed));
+	return start;
+}
+
+quint8 MonteCarloTree::makeState(Player player, Maybe<Player> winner)
+{
+	quint8 state = player == Player::Two ? MadeByTwo : 0;
+	if (winner.isSome()) {
+		state |= Terminal;
+		if (winner.get() == Player::Two) {
+			state |= WonByTwo;
+		}
+	}
+	return state;
+}
+
+Player MonteCarloTree::player(quint8 state)
+{
+	return (state & MadeByTwo) ? Player::Two : Player::One;
+}
+
+Player MonteCarloTree::winner(quint8 state)
+{
+	return (state & WonByTwo) ? Player::Two : Player::One;
+}
+
+int MonteCarloTree::selectChild(int index) const
+{
+	int first = firstChild_[index].load(std::memory_order_acquire);
+	double logVisits = std::log(double(qMax(visits_[index].load(std::memory_order_relaxed), 1u)));
+	int best = first;
+	double bestScore = -1;
+	for (int i = first; i < first + childCount_[index]; i++) {
+		quint32 visits = visits_[i].load(std::memory_order_relaxed);
+		if (visits == 0) {
+			return i;
+		}
+
+		double wins = wins_[i].load(std::memory_order_relaxed);
+		double score = wins / visits + exploration * std::sqrt(logVisits / visits);
+		if (score > bestScore) {
+			best = i;
+			bestScore = score;
+		}
+	}
+	return best;
+}
+
+int MonteCarloTree::expand(int index, Board& board, Worker& worker)
+{
+	int stepsBefore = board.currentMove().size();
+
+	// Count the moves first, so that they can be stored in one piece. Counting stops as soon
+	// as the moves can't fit in the arenas.
+	int childCount = 0;
+	int stepCount = 0;
+	bool stopped = false;
+	bool fits = board.enumerateMoves([&] (Board&, Move move) {
+		childCount++;
+		stepCount += move.size() - stepsBefore;
+		if (childCount % 1024 == 0 && worker.stop_ && worker.stop_()) {
+			stopped = true;
+			return false;
+		}
+		return childCount <= nodeCapacity_ - nodeCount_.load(std::memory_order_relaxed)
+			&& stepCount <= stepCapacity_ - stepCount_.load(std::memory_order_relaxed);
+	});
+	if (stopped) {
+		return -1;
+	}
+
+	int first = fits ? reserve(nodeCount_, nodeCapacity_, childCount) : -1;
+	if (first < 0) {
+		full_.store(true, std::memory_order_relaxed);
+		return -1;
+	}
+	int stepsStart = reserve(stepCount_, stepCapacity_, stepCount);
+	if (stepsStart < 0) {
+		// The reserved nodes are wasted, but the tree won't grow any more anyway.
+		full_.store(true, std::memory_order_relaxed);
+		return -1;
+	}
+
+	Player player = board.currentPlayer();
+	int child = first;
+	board.enumerateMoves([&] (Board& after, Move move) {
+		if ((child - first) % 1024 == 1023 && worker.stop_ && worker.stop_()) {
+			// The reserved space is wasted, the node stays a leaf.
+			stopped = true;
+			return false;
+		}
+		parent_[child] = index;
+		firstChild_[child].store(notExpanded, std::memory_order_relaxed);
+		childCount_[child] = 0;
+		stepsStart_[child] = stepsStart;
+		stepsCount_[child] = move.size() - stepsBefore;
+		state_[child] = makeState(player, after.winner());
+		visits_[child].store(0, std::memory_order_relaxed);
+		wins_[child].store(0, std::memory_order_relaxed);
+
+		for (int i = stepsBefore; i < move.size(); i++) {
+			steps_[stepsStart++] = move[i];
+		}
+		child++;
+		return true;
+	});
+	if (stopped) {
+		return -1;
+	}
+
+	childCount_[index] = childCount;
+	return first;
+}
+
+void MonteCarloTree::makeMove(int index, Board& board) const
+{
+	for (int i = stepsStart_[index]; i < stepsStart_[index] + stepsCount_[index]; i++) {
+		board.pushStep(steps_[i]);
+	}
+	if (board.winner().isNone()) {
+		board.endMove();
+	}
+}
+
+int MonteCarloTree::findNode(int index, const Board& nodeBoard, const Board& board, int maxMoves) const
+{
+	if (nodeBoard.hash() == board.hash()) {
+		return index;
+	}
+
+	int first = firstChild_[index].load(std::memory_order_acquire);
+	if (maxMoves == 0 || first < 0) {
+		return -1;
+	}
+
+	for (int i = first; i < first + childCount_[index]; i++) {
+		Board child = nodeBoard;
+		makeMove(i, child);
+		int found = findNode(i, child, board, maxMoves - 1);
+		if (found >= 0) {
+			return found;
+		}
+	}
+	return -1;
+}
+
+Player MonteCarloTree::playout(Board& board, quint64& randomState)
+{
+	while (true) {
+		randomSteps(board, randomState);
+		Maybe<Player> winner = board.winner();
+		if (winner.isSome()) {
+			return winner.get();
+		}
+		board.endMove();
+	}
+}
+
+void MonteCarloTree::randomSteps(Board& board, quint64& randomState)
+{
+	while (board.winner().isNone() && !board.canFinishMove()) {
+		// There is some free direction, otherwise there would be a winner.
+		quint8 free = board.stepDirections();
+		int count = 0;
+		for (Direction dir : directions) {
+			count += (free >> dir) & 1;
+		}
+
+		int chosen = random(randomState) % count;
+		for (Direction dir : directions) {
+			if ((free & (1 << dir)) && chosen-- == 0) {
+				board.pushStep(dir);
+				break;
+			}
+		}
+	}
+}
+
+quint32 MonteCarloTree::random(quint64& state)
+{
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return (state * 0x2545f4914f6cdd1d) >> 32;
+}
+
+} // namespace ps
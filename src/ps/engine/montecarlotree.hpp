@@ -0,0 +1,217 @@
+#ifndef PS_ENGINE_MONTECARLOTREE_HPP
+#define PS_ENGINE_MONTECARLOTREE_HPP
+
+#include "../models/board.hpp"
+
+#include <QtCore/QVector>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace ps {
+
+/**
+ * A search tree of the Monte Carlo tree search (UCT), shared by any number of threads.
+ *
+ * Every iteration descends the tree choosing children by the UCB1 formula, expands the reached
+ * leaf with all moves from Board::enumerateMoves and finishes the game by random steps
+ * (a playout). The winner of the playout is counted in all nodes on the path.
+ *
+ * Nodes are allocated from an arena preallocated for the whole memory budget, the fields of
+ * the nodes are stored in separate arrays and the children of a node are next to each other.
+ * The steps of the moves are kept in another arena. Iterations don't lock and don't allocate:
+ *     - counters are atomic, a visit is counted already on the way down (a virtual loss),
+ *       so that concurrent iterations spread over different children,
+ *     - a node is expanded by the thread that marks it first, others treat it as a leaf
+ *       until the children are published.
+ * 
+ * A tree can be kept for the next search: advancing the root to a later position keeps 
+ * the statistics of its subtree.
+ */
+class MonteCarloTree
+{
+public:
+	/**
+	 * The state of a thread running iterations: a board the moves are made on, the random
+	 * number generator of the playouts and the condition abandoning long expansions.
+	 */
+	class Worker
+	{
+	public:
+		/**
+		 * @param stop Checked while a node with many moves is expanded, the expansion is 
+		 *             abandoned if it returns true. Crowded boards can have more moves 
+		 *             than can be enumerated within the time limit.
+		 */
+		Worker(const MonteCarloTree& tree, int id, std::function<bool ()> stop = nullptr);
+
+	private:
+		Board board_;
+		quint64 randomState_;
+		std::function<bool ()> stop_;
+
+		friend class MonteCarloTree;
+	};
+
+	/**
+	 * Creates a tree with only the root.
+	 *
+	 * @param memoryLimit The size of the arenas, nodes are not expanded once they are full
+	 *                    (playouts start from the leaves instead).
+	 */
+	MonteCarloTree(const Board& board, size_t memoryLimit);
+
+	/**
+	 * Runs a single iteration: selection, expansion, playout and backpropagation.
+	 * Can be called by many threads at once, each with its own worker.
+	 */
+	void iterate(Worker& worker);
+
+	/**
+	 * Makes the node of @a board the new root, if it was reached by at most @a maxMoves moves 
+	 * from the current root (and the moves were expanded). The subtree of the node is copied 
+	 * to the start of new arenas, the rest of the tree is dropped. A subtree using more than
+	 * half of the arenas is not kept, the tree would soon be full again.
+	 * Call only when no iterations are running.
+	 * 
+	 * @returns whether the node was made the root, the tree is not changed otherwise.
+	 */
+	bool advance(const Board& board, int maxMoves);
+
+	/**
+	 * The number of iterations so far (including unfinished ones), including the iterations
+	 * of previous searches through the root if the root was advanced.
+	 */
+	quint64 playoutCount() const;
+
+	/**
+	 * The number of nodes in the tree.
+	 */
+	int nodeCount() const;
+
+	/**
+	 * The memory reserved for the tree, in bytes.
+	 */
+	size_t memoryUsage() const;
+
+	/**
+	 * Whether the result of the game from the root is already known.
+	 */
+	bool isSolved() const;
+
+	/**
+	 * The most visited move from the root (including the steps of the current move
+	 * made before the search started), none if there are no moves. If the root couldn't be
+	 * expanded (the arenas are too small or the expansion was stopped), it is the first move
+	 * of a playout. Call only when no iterations are running.
+	 */
+	Maybe<QVector<Direction>> bestMove() const;
+
+private:
+	/**
+	 * Bits of the node state.
+	 */
+	enum State : quint8
+	{
+		/**
+		 * The move leading to the node was made by player two.
+		 */
+		MadeByTwo = 1,
+
+		/**
+		 * The game is over in this node.
+		 */
+		Terminal = 2,
+
+		/**
+		 * Player two won, if the node is terminal.
+		 */
+		WonByTwo = 4
+	};
+
+	/**
+	 * Values of firstChild for nodes without children.
+	 */
+	static const int notExpanded = -1;
+	static const int expanding = -2;
+
+	/**
+	 * Reserves space in an arena.
+	 * @returns the start of the reserved space, or -1 if there is not enough space.
+	 */
+	static int reserve(std::atomic<int>& used, int capacity, int count);
+
+	static quint8 makeState(Player player, Maybe<Player> winner);
+	static Player player(quint8 state);
+	static Player winner(quint8 state);
+
+	/**
+	 * Chooses the child with the best upper confidence bound, unvisited children first.
+	 */
+	int selectChild(int index) const;
+
+	/**
+	 * Adds the children of a node, the board must be in the node's position. Sets full_
+	 * if they don't fit in the arenas.
+	 * @returns the first child, or -1 if the arenas are full or worker.stop_ stopped
+	 *          the expansion.
+	 */
+	int expand(int index, Board& board, Worker& worker);
+
+	/**
+	 * Makes the move leading to the node on the board.
+	 */
+	void makeMove(int index, Board& board) const;
+
+	/**
+	 * Finds a node of the subtree of @a index, reached by at most @a maxMoves moves, 
+	 * whose position is @a board. The position of @a index is @a nodeBoard.
+	 * @returns the node or -1.
+	 */
+	int findNode(int index, const Board& nodeBoard, const Board& board, int maxMoves) const;
+
+	/**
+	 * Plays random steps until the game is over.
+	 * @returns the winner.
+	 */
+	static Player playout(Board& board, quint64& randomState);
+
+	/**
+	 * Plays random steps until the current move can be finished or the game is over.
+	 */
+	static void randomSteps(Board& board, quint64& randomState);
+
+	/**
+	 * A pseudo-random number generator for playouts (xorshift64*).
+	 */
+	static quint32 random(quint64& state);
+
+	Board rootBoard_;
+
+	// The node arena.
+	int nodeCapacity_;
+	std::atomic<int> nodeCount_;
+	std::unique_ptr<int[]> parent_;
+	std::unique_ptr<std::atomic<int>[]> firstChild_;
+	std::unique_ptr<int[]> childCount_;
+	std::unique_ptr<int[]> stepsStart_;
+	std::unique_ptr<quint16[]> stepsCount_;
+	std::unique_ptr<quint8[]> state_;
+	std::unique_ptr<std::atomic<quint32>[]> visits_;
+	std::unique_ptr<std::atomic<quint32>[]> wins_;
+
+	// The step arena.
+	int stepCapacity_;
+	std::atomic<int> stepCount_;
+	std::unique_ptr<Direction[]> steps_;
+
+	/**
+	 * Set when an expansion didn't fit, no more expansions are tried.
+	 */
+	std::atomic<bool> full_;
+};
+
+} // namespace ps
+
+#endif // PS_ENGINE_MONTECARLOTREE_HPP
@@ -0,0 +1,162 @@
+#include "openingbook.hpp"
+
+#include <QtCore/QtEndian>
+
+#include <cstring>
+
+namespace ps {
+
+OpeningBook::OpeningBook()
+	: data(nullptr)
+	, header()
+	, positions(nullptr)
+	, moves(nullptr)
+	, steps(nullptr)
+{
+}
+
+OpeningBook::~OpeningBook()
+{
+	close();
+}
+
+bool OpeningBook::open(const QString& fileName)
+{
+	close();
+	file.setFileName(fileName);
+	if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(Header))) {
+		close();
+		return false;
+	}
+
+	data = file.map(0, file.size());
+	if (data == nullptr) {
+		close();
+		return false;
+	}
+
+	std::memcpy(&header, data, sizeof(Header));
+	header.magic = qFromLittleEndian(header.magic);
+	header.version = qFromLittleEndian(header.version);
+	header.width = qFromLittleEndian(header.width);
+	header.height = qFromLittleEndian(header.height);
+	header.positionCount = qFromLittleEndian(header.positionCount);
+	header.moveCount = qFromLittleEndian(header.moveCount);
+	header.stepCount = qFromLittleEndian(header.stepCount);
+	quint64 positionsSize = quint64(header.positionCount) * sizeof(Position);
+	quint64 movesSize = quint64(header.moveCount) * sizeof(BookMove);
+	if (header.magic != magic || header.version != formatVersion
+		|| quint64(file.size()) != sizeof(Header) + positionsSize + movesSize + header.stepCount) {
+		close();
+		return false;
+	}
+
+	// The ranges are checked once here, so that choose can trust them.
+	positions = reinterpret_cast<const Position*>(data + sizeof(Header));
+	moves = reinterpret_cast<const BookMove*>(data + sizeof(Header) + positionsSize);
+	steps = reinterpret_cast<const Direction*>(data + sizeof(Header) + positionsSize + movesSize);
+	for (quint32 i = 0; i < header.positionCount; i++) {
+		quint64 end = quint64(qFromLittleEndian(positions[i].firstMove))
+			+ qFromLittleEndian(positions[i].moveCount);
+		bool sorted = i == 0 || qFromLittleEndian(positions[i - 1].hash) < qFromLittleEndian(positions[i].hash);
+		if (end > header.moveCount || !sorted) {
+			close();
+			return false;
+		}
+	}
+	for (quint32 i = 0; i < header.moveCount; i++) {
+		quint64 end = quint64(qFromLittleEndian(moves[i].firstStep))
+			+ qFromLittleEndian(moves[i].stepCount);
+		if (end > header.stepCount) {
+			close();
+			return false;
+		}
+	}
+	for (quint32 i = 0; i < header.stepCount; i++) {
+		if (steps[i] > West) {
+			close();
+			return false;
+		}
+	}
+
+	size_ = QSize(header.width, header.height);
+	return true;
+}
+
+void OpeningBook::close()
+{
+	// Closing the file unmaps it.
+	file.close();
+	data = nullptr;
+	header = Header();
+	positions = nullptr;
+	moves = nullptr;
+	steps = nullptr;
+	size_ = QSize();
+}
+
+bool OpeningBook::isOpen() const
+{
+	return data != nullptr;
+}
+
+QString OpeningBook::fileName() const
+{
+	return file.fileName();
+}
+
+QSize OpeningBook::size() const
+{
+	return size_;
+}
+
+int OpeningBook::positionCount() const
+{
+	return header.positionCount;
+}
+
+Maybe<Move> OpeningBook::choose(const Board& board, quint64 random) const
+{
+	// Board::size() counts the rows of the gates.
+	QSize size(board.size().width(), board.size().height() - 2);
+	if (data == nullptr || size != size_ || !board.currentMove().empty()) {
+		return none;
+	}
+
+	quint64 hash = board.hash();
+	quint32 begin = 0;
+	quint32 end = header.positionCount;
+	while (begin < end) {
+		quint32 middle = begin + (end - begin) / 2;
+		if (qFromLittleEndian(positions[middle].hash) < hash) {
+			begin = middle + 1;
+		} else {
+			end = middle;
+		}
+	}
+	if (begin == header.positionCount || qFromLittleEndian(positions[begin].hash) != hash) {
+		return none;
+	}
+
+	const BookMove* first = moves + qFromLittleEndian(positions[begin].firstMove);
+	const BookMove* last = first + qFromLittleEndian(positions[begin].moveCount);
+	quint64 total = 0;
+	for (const BookMove* move = first; move != last; move++) {
+		total += qFromLittleEndian(move->weight);
+	}
+	if (total == 0) {
+		return none;
+	}
+
+	quint64 chosen = random % total;
+	for (const BookMove* move = first; move != last; move++) {
+		quint32 weight = qFromLittleEndian(move->weight);
+		if (chosen < weight) {
+			return Move(steps + qFromLittleEndian(move->firstStep), qFromLittleEndian(move->stepCount));
+		}
+		chosen -= weight;
+	}
+	return none;
+}
+
+} // namespace ps
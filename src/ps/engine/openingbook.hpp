@@ -0,0 +1,104 @@
+#ifndef PS_ENGINE_OPENINGBOOK_HPP
+#define PS_ENGINE_OPENINGBOOK_HPP
+
+#include "../maybe.hpp"
+#include "../models/board.hpp"
+#include "../models/move.hpp"
+
+#include <QtCore/QFile>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+
+namespace ps {
+
+/**
+ * Weighted moves of positions at the start of a turn, read from a file made by
+ * OpeningBookBuilder.
+ *
+ * The file has a header, an index of positions sorted by Board::hash(), the moves of all
+ * positions and their steps. Every position points to a range of moves and every move to
+ * a range of steps, all numbers are little-endian. The file is mapped into memory, so a book
+ * is opened instantly and a move is found by a binary search, without allocating memory.
+ */
+class OpeningBook
+{
+public:
+	struct Header
+	{
+		quint32 magic;
+		quint32 version;
+		quint32 width;
+		quint32 height;
+		quint32 positionCount;
+		quint32 moveCount;
+		quint32 stepCount;
+		quint32 reserved;
+	};
+
+	struct Position
+	{
+		quint64 hash;
+		quint32 firstMove;
+		quint32 moveCount;
+	};
+
+	struct BookMove
+	{
+		/**
+		 * How often the move is chosen relative to the other moves of the position.
+		 */
+		quint32 weight;
+		quint32 firstStep;
+		quint32 stepCount;
+	};
+
+	static const quint32 magic = 0x424f5350; // "PSOB"
+	/**
+	 * Version 2: Board::hash() includes the border edges.
+	 */
+	static const quint32 formatVersion = 2;
+
+	OpeningBook();
+	~OpeningBook();
+
+	/**
+	 * Maps the file @a fileName, replacing the current one.
+	 * @returns whether it is a valid book, it is closed otherwise.
+	 */
+	bool open(const QString& fileName);
+	void close();
+	bool isOpen() const;
+
+	/**
+	 * The file name of the open book.
+	 */
+	QString fileName() const;
+
+	/**
+	 * The board size of the open book, as in GameConfig (without the gates).
+	 */
+	QSize size() const;
+
+	int positionCount() const;
+
+	/**
+	 * Chooses one of the moves of @a board at random, with the probabilities proportional
+	 * to the weights. @a random is any random number. Doesn't allocate memory.
+	 * @returns a view of the steps in the file, or none if the board is not in the book
+	 *          (or its current move isn't empty).
+	 */
+	Maybe<Move> choose(const Board& board, quint64 random) const;
+
+private:
+	QFile file;
+	const uchar* data;
+	QSize size_;
+	Header header;
+	const Position* positions;
+	const BookMove* moves;
+	const Direction* steps;
+};
+
+} // namespace ps
+
+#endif // PS_ENGINE_OPENINGBOOK_HPP
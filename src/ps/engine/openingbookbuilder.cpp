@@ -0,0 +1,123 @@
+#include "openingbookbuilder.hpp"
+#include "openingbook.hpp"
+#include "../ai.hpp"
+
+#include <QtCore/QFile>
+#include <QtCore/QtEndian>
+
+namespace ps {
+
+OpeningBookBuilder::OpeningBookBuilder(QSize size, const AIConfig& config, int depth, quint64 seed)
+	: size(size)
+	, config(config)
+	, depth(qMax(1, depth))
+	, random(seed)
+{
+}
+
+void OpeningBookBuilder::setLog(std::function<void (const QString&)> log)
+{
+	this->log = log;
+}
+
+void OpeningBookBuilder::play(int gameCount, const CancellationToken& token)
+{
+	AI ai;
+	for (int game = 0; game < gameCount && !token.isCancelled(); game++) {
+		Board board(size);
+		int randomTurn = random() % depth;
+		for (int turn = 0; turn < depth && board.winner().isNone(); turn++) {
+			QVector<Direction> move;
+			if (turn == randomTurn) {
+				move = randomMove(board);
+			} else {
+				Maybe<Board> result = ai.search(board, config, token);
+				if (result.isNone()) {
+					break;
+				}
+				move = result.get().currentMove().toVector();
+				add(board, move);
+			}
+
+			board.setCurrentMove(move);
+			if (board.winner().isNone()) {
+				board.finishMove();
+			}
+		}
+		if (log) {
+			log(QStringLiteral("Game %1: %2 positions").arg(game + 1).arg(positionCount()));
+		}
+	}
+}
+
+void OpeningBookBuilder::add(const Board& board, const QVector<Direction>& move, quint32 weight)
+{
+	Q_ASSERT(board.currentMove().empty());
+	positions[board.hash()][move] += weight;
+}
+
+int OpeningBookBuilder::positionCount() const
+{
+	return int(positions.size());
+}
+
+bool OpeningBookBuilder::write(const QString& fileName)
+{
+	QVector<OpeningBook::Position> index;
+	QVector<OpeningBook::BookMove> moves;
+	QVector<Direction> steps;
+	for (const auto& position : positions) {
+		index.append({qToLittleEndian(position.first), qToLittleEndian(quint32(moves.size())),
+			qToLittleEndian(quint32(position.second.size()))});
+		for (const auto& move : position.second) {
+			moves.append({qToLittleEndian(move.second), qToLittleEndian(quint32(steps.size())),
+				qToLittleEndian(quint32(move.first.size()))});
+			steps += move.first;
+		}
+	}
+
+	OpeningBook::Header header;
+	header.magic = qToLittleEndian(OpeningBook::magic);
+	header.version = qToLittleEndian(OpeningBook::formatVersion);
+	header.width = qToLittleEndian(quint32(size.width()));
+	header.height = qToLittleEndian(quint32(size.height()));
+	header.positionCount = qToLittleEndian(quint32(index.size()));
+	header.moveCount = qToLittleEndian(quint32(moves.size()));
+	header.stepCount = qToLittleEndian(quint32(steps.size()));
+	header.reserved = 0;
+
+	QFile file(fileName);
+	qint64 indexSize = index.size() * sizeof(OpeningBook::Position);
+	qint64 movesSize = moves.size() * sizeof(OpeningBook::BookMove);
+	if (!file.open(QIODevice::WriteOnly)
+		|| file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)
+		|| file.write(reinterpret_cast<const char*>(index.constData()), indexSize) != indexSize
+		|| file.write(reinterpret_cast<const char*>(moves.constData()), movesSize) != movesSize
+		|| file.write(reinterpret_cast<const char*>(steps.constData()), steps.size()) != steps.size()) {
+		errorString_ = QStringLiteral("Can't write %1: %2").arg(fileName, file.errorString());
+		return false;
+	}
+	return true;
+}
+
+QString OpeningBookBuilder::errorString() const
+{
+	return errorString_;
+}
+
+QVector<Direction> OpeningBookBuilder::randomMove(Board& board)
+{
+	// Reservoir sampling, the number of moves is not known in advance.
+	QVector<Direction> chosen;
+	quint64 count = 0;
+	board.enumerateMoves([&] (Board&, Move move) {
+		count++;
+		if (random() % count == 0) {
+			chosen = move.toVector();
+		}
+		return true;
+	});
+	return chosen;
+}
+
+} // namespace ps
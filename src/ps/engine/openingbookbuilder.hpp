@@ -0,0 +1,82 @@
+#ifndef PS_ENGINE_OPENINGBOOKBUILDER_HPP
+#define PS_ENGINE_OPENINGBOOKBUILDER_HPP
+
+#include "../models/aiconfig.hpp"
+#include "../models/board.hpp"
+#include "../cancellationtoken.hpp"
+
+#include <QtCore/QSize>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include <functional>
+#include <map>
+#include <random>
+
+namespace ps {
+
+/**
+ * Builds an OpeningBook from games of the AI against itself.
+ *
+ * Every game plays the first turns (the book depth) with the AI, except for one turn
+ * chosen at random, where a random move is played so that the games differ. The moves
+ * chosen by the AI are added to the book, the weight of a move is the number of games in
+ * which it was chosen. The book can be written at any time and the games can go on.
+ */
+class OpeningBookBuilder
+{
+public:
+	/**
+	 * Creates a builder of a book for boards of @a size (without the gates), with moves of
+	 * the first @a depth turns searched with @a config.
+	 */
+	OpeningBookBuilder(QSize size, const AIConfig& config, int depth, quint64 seed);
+
+	/**
+	 * Receives progress messages.
+	 */
+	void setLog(std::function<void (const QString&)> log);
+
+	/**
+	 * Plays @a gameCount games, or less if cancelled.
+	 */
+	void play(int gameCount, const CancellationToken& token = CancellationToken());
+
+	/**
+	 * Adds @a weight to the weight of @a move in the position @a board, whose current move
+	 * must be empty.
+	 */
+	void add(const Board& board, const QVector<Direction>& move, quint32 weight = 1);
+
+	int positionCount() const;
+
+	/**
+	 * Writes the book to @a fileName.
+	 * @returns false and sets errorString if the file couldn't be written.
+	 */
+	bool write(const QString& fileName);
+
+	QString errorString() const;
+
+private:
+	/**
+	 * Chooses a move of @a board uniformly at random.
+	 */
+	QVector<Direction> randomMove(Board& board);
+
+	QSize size;
+	AIConfig config;
+	int depth;
+	std::mt19937_64 random;
+	std::function<void (const QString&)> log;
+	QString errorString_;
+
+	/**
+	 * The weights of moves by positions, sorted like in the file.
+	 */
+	std::map<quint64, std::map<QVector<Direction>, quint32>> positions;
+};
+
+} // namespace ps
+
+#endif // PS_ENGINE_OPENINGBOOKBUILDER_HPP
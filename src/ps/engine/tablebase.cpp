@@ -0,0 +1,153 @@
+#include "tablebase.hpp"
+
+#include <QtCore/QStandardPaths>
+#include <QtCore/QtEndian>
+
+#include <cstring>
+
+namespace ps {
+
+namespace {
+
+quint64 mix(quint64 z)
+{
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+} // namespace
+
+Tablebase::Tablebase()
+	: entries(nullptr)
+	, count_(0)
+{
+}
+
+Tablebase::~Tablebase()
+{
+	close();
+}
+
+bool Tablebase::open(const QString& fileName)
+{
+	close();
+	file.setFileName(fileName);
+	if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(Header))) {
+		close();
+		return false;
+	}
+
+	const uchar* data = file.map(0, file.size());
+	if (data == nullptr) {
+		close();
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, data, sizeof(Header));
+	quint64 count = qFromLittleEndian(header.count);
+	if (qFromLittleEndian(header.magic) != magic
+		|| qFromLittleEndian(header.version) != formatVersion
+		|| quint64(file.size()) != sizeof(Header) + count * sizeof(quint64)) {
+		close();
+		return false;
+	}
+
+	entries = reinterpret_cast<const quint64*>(data + sizeof(Header));
+	count_ = count;
+	size_ = QSize(qFromLittleEndian(header.width), qFromLittleEndian(header.height));
+	return true;
+}
+
+void Tablebase::close()
+{
+	// Closing the file unmaps it.
+	file.close();
+	entries = nullptr;
+	count_ = 0;
+	size_ = QSize();
+}
+
+bool Tablebase::isOpen() const
+{
+	return entries != nullptr;
+}
+
+QSize Tablebase::size() const
+{
+	return size_;
+}
+
+quint64 Tablebase::count() const
+{
+	return count_;
+}
+
+Maybe<bool> Tablebase::probe(const Board& board) const
+{
+	// Board::size() counts the rows of the gates.
+	quint64 edges[wordCount];
+	QSize size(board.size().width(), board.size().height() - 2);
+	if (entries == nullptr || size != size_ || !visitedEdges(board, edges)) {
+		return none;
+	}
+
+	// The entries are sorted by key, the result bit doesn't change the order of keys.
+	quint64 wanted = key(edges, board.ball(), board.currentPlayer());
+	quint64 begin = 0;
+	quint64 end = count_;
+	while (begin < end) {
+		quint64 middle = begin + (end - begin) / 2;
+		quint64 entry = qFromLittleEndian(entries[middle]);
+		if ((entry & ~1ull) < wanted) {
+			begin = middle + 1;
+		} else if ((entry & ~1ull) > wanted) {
+			end = middle;
+		} else {
+			return (entry & 1) != 0;
+		}
+	}
+	return none;
+}
+
+quint64 Tablebase::key(const quint64* edges, QPoint ball, Player player)
+{
+	quint64 key = mix(0x9e3779b97f4a7c15ull ^ quint64(quint8(ball.x())) 
+		^ quint64(quint8(ball.y())) << 8 ^ quint64(player) << 16);
+	for (int i = 0; i < wordCount; i++) {
+		key = mix(key ^ edges[i]);
+	}
+	return key & ~1ull;
+}
+
+bool Tablebase::visitedEdges(const Board& board, quint64* edges)
+{
+	for (int i = 0; i < wordCount; i++) {
+		edges[i] = 0;
+	}
+
+	int i = 0;
+	for (const Edge& edge : board.edgesInside()) {
+		if (board.edgeCategory(edge) == EdgeCategory::Border) {
+			continue;
+		}
+		if (i == maxEdges) {
+			return false;
+		}
+		if (board.isEdgeVisited(edge)) {
+			edges[i / 64] |= 1ull << (i % 64);
+		}
+		i++;
+	}
+	return true;
+}
+
+QString Tablebase::fileName(QSize size)
+{
+	return QStringLiteral("%1/tablebases/%2x%3.pstb")
+		.arg(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+		.arg(size.width()).arg(size.height());
+}
+
+} // namespace ps
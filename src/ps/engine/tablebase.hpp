@@ -0,0 +1,102 @@
+#ifndef PS_ENGINE_TABLEBASE_HPP
+#define PS_ENGINE_TABLEBASE_HPP
+
+#include "../maybe.hpp"
+#include "../models/board.hpp"
+
+#include <QtCore/QFile>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+
+namespace ps {
+
+/**
+ * Results of all positions of a small board, read from a file made by TablebaseGenerator.
+ *
+ * A position is the state before a step with no steps of the current move made: the visited
+ * edges, the ball and the player making the next step. The generator stores the steps of
+ * a bouncing move as old edges, so the player bouncing is on move in a new position.
+ * A board in the middle of a move is not such a position (it may be allowed to finish
+ * the move), its probe would give a wrong result and AI doesn't look it up.
+ *
+ * The file is a header followed by a sorted array of 64-bit little-endian entries, an entry
+ * is the key of a position with the lowest bit set if the player on move wins. The file
+ * is mapped into memory, so it is loaded instantly and shared by all processes using it.
+ */
+class Tablebase
+{
+public:
+	/**
+	 * The number of 64-bit words holding the visited edges of a position, which limits
+	 * the board size to 128 edges that aren't a part of the border.
+	 */
+	static const int wordCount = 2;
+	static const int maxEdges = wordCount * 64;
+
+	struct Header
+	{
+		quint32 magic;
+		quint32 version;
+		quint32 width;
+		quint32 height;
+		quint64 count;
+	};
+
+	static const quint32 magic = 0x42545350; // "PSTB"
+	static const quint32 formatVersion = 1;
+
+	Tablebase();
+	~Tablebase();
+
+	/**
+	 * Maps the file @a fileName, replacing the current one.
+	 * @returns whether it is a valid tablebase, it is closed otherwise.
+	 */
+	bool open(const QString& fileName);
+	void close();
+	bool isOpen() const;
+
+	/**
+	 * The board size of the open tablebase, as in GameConfig (without the gates).
+	 */
+	QSize size() const;
+
+	/**
+	 * The number of positions.
+	 */
+	quint64 count() const;
+
+	/**
+	 * Finds whether the player on move on @a board can force a win. Doesn't allocate memory.
+	 * @returns none if the tablebase is not open, it is for another size or the position
+	 *          is not in it (positions where the game is over are not stored).
+	 */
+	Maybe<bool> probe(const Board& board) const;
+
+	/**
+	 * The key of a position: @a edges has the bit i set if the i-th edge of
+	 * Board::edgesInside(), not counting the border, was visited. The lowest bit is 0.
+	 */
+	static quint64 key(const quint64* edges, QPoint ball, Player player);
+
+	/**
+	 * The visited edges of @a board, as used by key.
+	 * @returns false if the board has too many edges.
+	 */
+	static bool visitedEdges(const Board& board, quint64* edges);
+
+	/**
+	 * The default location of the tablebase for @a size (without the gates), where AI looks for it.
+	 */
+	static QString fileName(QSize size);
+
+private:
+	QFile file;
+	const quint64* entries;
+	quint64 count_;
+	QSize size_;
+};
+
+} // namespace ps
+
+#endif // PS_ENGINE_TABLEBASE_HPP
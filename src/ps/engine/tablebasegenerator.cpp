@@ -0,0 +1,383 @@
+#include "tablebasegenerator.hpp"
+
+#include <QtCore/QFile>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+#include <QtCore/QtEndian>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+namespace ps {
+
+namespace {
+
+class Task : public QRunnable
+{
+public:
+	explicit Task(std::function<void ()> f)
+		: f(f)
+	{
+	}
+
+	void run() override
+	{
+		f();
+	}
+
+private:
+	std::function<void ()> f;
+};
+
+/**
+ * The number of ranges a level is split into per thread, so that threads finishing early
+ * take over the work of the others.
+ */
+const int chunksPerThread = 16;
+
+} // namespace
+
+bool TablebaseGenerator::State::operator <(const State& other) const
+{
+	return std::memcmp(this, &other, sizeof(State)) < 0;
+}
+
+bool TablebaseGenerator::State::operator ==(const State& other) const
+{
+	return std::memcmp(this, &other, sizeof(State)) == 0;
+}
+
+TablebaseGenerator::TablebaseGenerator(QSize size, const QString& workDirectory, int threadCount)
+	: size(size)
+	, directory(workDirectory)
+	, threadCount(qMax(1, threadCount))
+	, levelCount(0)
+{
+	Board empty(size);
+	for (const Edge& edge : empty.edgesInside()) {
+		if (empty.edgeCategory(edge) != EdgeCategory::Border) {
+			edges.append(edge);
+		}
+	}
+}
+
+void TablebaseGenerator::setLog(std::function<void (const QString&)> log)
+{
+	log_ = log;
+}
+
+bool TablebaseGenerator::run(const QString& fileName)
+{
+	errorString_.clear();
+	if (edges.size() > Tablebase::maxEdges) {
+		errorString_ = QStringLiteral("The board has %1 edges, at most %2 are supported.")
+			.arg(edges.size()).arg(Tablebase::maxEdges);
+		return false;
+	}
+	if (!directory.mkpath(QStringLiteral("."))) {
+		errorString_ = QStringLiteral("Can't create %1.").arg(directory.path());
+		return false;
+	}
+
+	return generateLevels() && solveLevels() && writeTablebase(fileName);
+}
+
+QString TablebaseGenerator::errorString() const
+{
+	return errorString_;
+}
+
+bool TablebaseGenerator::generateLevels()
+{
+	// Continue from the last saved level, the level after it is generated again.
+	std::vector<State> level;
+	int last = 0;
+	while (QFile::exists(statesFile(last + 1))) {
+		last++;
+	}
+	if (last == 0 && !QFile::exists(statesFile(0))) {
+		level.push_back(encode(Board(size)));
+		if (!save(statesFile(0), level)) {
+			return false;
+		}
+	} else if (!load(statesFile(last), level)) {
+		return false;
+	}
+
+	while (!level.empty()) {
+		std::vector<State> next;
+		std::mutex mutex;
+		parallel(level.size(), [&] (size_t begin, size_t end) {
+			std::vector<State> found;
+			Child children[8];
+			for (size_t i = begin; i < end; i++) {
+				int count = expand(level[i], children);
+				for (int j = 0; j < count; j++) {
+					if (!children[j].over) {
+						found.push_back(children[j].state);
+					}
+				}
+			}
+			std::sort(found.begin(), found.end());
+			found.erase(std::unique(found.begin(), found.end()), found.end());
+			std::lock_guard<std::mutex> lock(mutex);
+			next.insert(next.end(), found.begin(), found.end());
+		});
+		std::sort(next.begin(), next.end());
+		next.erase(std::unique(next.begin(), next.end()), next.end());
+
+		last++;
+		if (!save(statesFile(last), next)) {
+			return false;
+		}
+		log(QStringLiteral("Level %1: %2 positions").arg(last).arg(next.size()));
+		level.swap(next);
+	}
+
+	levelCount = last + 1;
+	return true;
+}
+
+bool TablebaseGenerator::solveLevels()
+{
+	// The last level is empty, every level is solved from the results of the next one.
+	std::vector<State> next;
+	std::vector<quint8> nextResults;
+	for (int level = levelCount - 2; level >= 0; level--) {
+		std::vector<State> states;
+		std::vector<quint8> results;
+		if (!load(statesFile(level), states)) {
+			return false;
+		}
+
+		if (QFile::exists(resultsFile(level))) {
+			if (!load(resultsFile(level), results)) {
+				return false;
+			}
+			if (results.size() != states.size()) {
+				errorString_ = QStringLiteral("%1 doesn't match %2, delete it.")
+					.arg(resultsFile(level), statesFile(level));
+				return false;
+			}
+		} else {
+			// The children are missing from the next level if its file is from another board.
+			std::atomic<bool> missing(false);
+			results.resize(states.size());
+			parallel(states.size(), [&] (size_t begin, size_t end) {
+				Child children[8];
+				for (size_t i = begin; i < end && !missing.load(std::memory_order_relaxed); i++) {
+					int count = expand(states[i], children);
+					bool won = false;
+					for (int j = 0; j < count && !won; j++) {
+						const Child& child = children[j];
+						if (child.over) {
+							won = child.won;
+							continue;
+						}
+						auto found = std::lower_bound(next.begin(), next.end(), child.state);
+						if (found == next.end() || !(*found == child.state)) {
+							missing.store(true, std::memory_order_relaxed);
+							break;
+						}
+						bool childWon = nextResults[found - next.begin()] != 0;
+						won = child.state.player == states[i].player ? childWon : !childWon;
+					}
+					results[i] = won;
+				}
+			});
+			if (missing) {
+				errorString_ = QStringLiteral("%1 lacks positions reached from level %2, delete it.")
+					.arg(statesFile(level + 1)).arg(level);
+				return false;
+			}
+			if (!save(resultsFile(level), results)) {
+				return false;
+			}
+			log(QStringLiteral("Level %1: %2 won positions")
+				.arg(level).arg(std::count(results.begin(), results.end(), 1)));
+		}
+
+		next.swap(states);
+		nextResults.swap(results);
+	}
+	return true;
+}
+
+bool TablebaseGenerator::writeTablebase(const QString& fileName)
+{
+	std::vector<quint64> entries;
+	for (int level = 0; level < levelCount - 1; level++) {
+		std::vector<State> states;
+		std::vector<quint8> results;
+		if (!load(statesFile(level), states) || !load(resultsFile(level), results)) {
+			return false;
+		}
+		for (size_t i = 0; i < states.size(); i++) {
+			QPoint ball(states[i].x, states[i].y);
+			entries.push_back(Tablebase::key(states[i].edges, ball, states[i].player) | results[i]);
+		}
+	}
+	std::sort(entries.begin(), entries.end());
+
+	// Keys of different positions are different with overwhelming probability,
+	// but a collision would make the tablebase lie, so it is checked.
+	for (size_t i = 1; i < entries.size(); i++) {
+		if ((entries[i] & ~1ull) == (entries[i - 1] & ~1ull)) {
+			errorString_ = QStringLiteral("Two positions have the same key.");
+			return false;
+		}
+	}
+
+	Tablebase::Header header;
+	header.magic = qToLittleEndian(Tablebase::magic);
+	header.version = qToLittleEndian(Tablebase::formatVersion);
+	header.width = qToLittleEndian(quint32(size.width()));
+	header.height = qToLittleEndian(quint32(size.height()));
+	header.count = qToLittleEndian(quint64(entries.size()));
+	for (quint64& entry : entries) {
+		entry = qToLittleEndian(entry);
+	}
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly)
+		|| file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header)
+		|| file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(quint64))
+			!= qint64(entries.size() * sizeof(quint64))) {
+		errorString_ = QStringLiteral("Can't write %1: %2").arg(fileName, file.errorString());
+		return false;
+	}
+	log(QStringLiteral("Wrote %1 positions to %2").arg(entries.size()).arg(fileName));
+	return true;
+}
+
+int TablebaseGenerator::expand(const State& state, Child* children) const
+{
+	Board board = decode(state);
+	int count = 0;
+	for (Direction dir : directions) {
+		if (!board.canStepInDirection(dir)) {
+			continue;
+		}
+
+		// The child is the position before the next step, so a complete move is finished
+		// and the edges of a bouncing move become old, as they are in decode.
+		Child& child = children[count++];
+		Board next = board;
+		next.pushStep(dir);
+		Maybe<Player> winner = next.winner();
+		if (winner.isNone()) {
+			if (next.canFinishMove()) {
+				next.endMove();
+				winner = next.winner();
+			} else {
+				next.convertCurrentMoveToOldEdges();
+			}
+		}
+		child.over = winner.isSome();
+		child.won = child.over && winner.get() == state.player;
+		child.state = encode(next);
+	}
+	return count;
+}
+
+TablebaseGenerator::State TablebaseGenerator::encode(const Board& board) const
+{
+	State state;
+	std::memset(&state, 0, sizeof(State));
+	Tablebase::visitedEdges(board, state.edges);
+	state.x = board.ball().x();
+	state.y = board.ball().y();
+	state.player = board.currentPlayer();
+	return state;
+}
+
+Board TablebaseGenerator::decode(const State& state) const
+{
+	Board board(size);
+	for (int i = 0; i < edges.size(); i++) {
+		if (state.edges[i / 64] & (1ull << (i % 64))) {
+			board.setEdgeCategory(edges[i], EdgeCategory::Old);
+		}
+	}
+	board.setBall(QPoint(state.x, state.y));
+	board.setCurrentPlayer(state.player);
+	return board;
+}
+
+void TablebaseGenerator::parallel(size_t count, std::function<void (size_t, size_t)> f) const
+{
+	size_t chunkCount = size_t(threadCount) * chunksPerThread;
+	size_t chunkSize = qMax<size_t>(1, (count + chunkCount - 1) / chunkCount);
+	std::atomic<size_t> nextChunk(0);
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(threadCount);
+	for (int i = 0; i < threadCount; i++) {
+		pool.start(new Task([&] () {
+			for (size_t begin = nextChunk++ * chunkSize; begin < count; begin = nextChunk++ * chunkSize) {
+				f(begin, qMin(count, begin + chunkSize));
+			}
+		}));
+	}
+	pool.waitForDone();
+}
+
+QString TablebaseGenerator::statesFile(int level) const
+{
+	return directory.filePath(QStringLiteral("states-%1.bin").arg(level, 3, 10, QLatin1Char('0')));
+}
+
+QString TablebaseGenerator::resultsFile(int level) const
+{
+	return directory.filePath(QStringLiteral("results-%1.bin").arg(level, 3, 10, QLatin1Char('0')));
+}
+
+template<typename T>
+bool TablebaseGenerator::load(const QString& fileName, std::vector<T>& data)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly) || file.size() % sizeof(T) != 0) {
+		errorString_ = QStringLiteral("Can't read %1: %2").arg(fileName, file.errorString());
+		return false;
+	}
+	data.resize(file.size() / sizeof(T));
+	qint64 bytes = data.size() * sizeof(T);
+	if (file.read(reinterpret_cast<char*>(data.data()), bytes) != bytes) {
+		errorString_ = QStringLiteral("Can't read %1: %2").arg(fileName, file.errorString());
+		return false;
+	}
+	return true;
+}
+
+template<typename T>
+bool TablebaseGenerator::save(const QString& fileName, const std::vector<T>& data)
+{
+	// A file only appears when it is complete, so an interrupted run never finds
+	// a partial level.
+	QString temporary = fileName + QStringLiteral(".part");
+	QFile file(temporary);
+	qint64 bytes = data.size() * sizeof(T);
+	if (!file.open(QIODevice::WriteOnly)
+		|| file.write(reinterpret_cast<const char*>(data.data()), bytes) != bytes) {
+		errorString_ = QStringLiteral("Can't write %1: %2").arg(temporary, file.errorString());
+		return false;
+	}
+	file.close();
+	QFile::remove(fileName);
+	if (!QFile::rename(temporary, fileName)) {
+		errorString_ = QStringLiteral("Can't rename %1 to %2.").arg(temporary, fileName);
+		return false;
+	}
+	return true;
+}
+
+void TablebaseGenerator::log(const QString& message) const
+{
+	if (log_) {
+		log_(message);
+	}
+}
+
+} // namespace ps
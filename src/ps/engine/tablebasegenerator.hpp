@@ -0,0 +1,134 @@
+#ifndef PS_ENGINE_TABLEBASEGENERATOR_HPP
+#define PS_ENGINE_TABLEBASEGENERATOR_HPP
+
+#include "tablebase.hpp"
+#include "../models/board.hpp"
+
+#include <QtCore/QDir>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+
+#include <functional>
+#include <vector>
+
+namespace ps {
+
+/**
+ * Solves all positions reachable on a small board and writes them as a Tablebase.
+ *
+ * Every step visits one more edge, so the positions form levels by the number of visited
+ * edges. The generator enumerates the levels forwards from the empty board and then solves
+ * them backwards from the last one (retrograde analysis): the player on move wins if a step
+ * wins the game, or leads to a position won by the same player (a bounce) or lost by the
+ * opponent (the end of the move). The levels are expanded and solved by several threads.
+ *
+ * Every level and its results are saved in the work directory as soon as they are done,
+ * so an interrupted generation can be run again and continues where it stopped.
+ * The number of positions grows very quickly with the board size: a board with 2 columns
+ * and 4 rows has under a million, a 4 by 4 board has tens of millions in the first 12
+ * of its 70 levels.
+ */
+class TablebaseGenerator
+{
+public:
+	/**
+	 * Creates a generator of the tablebase for boards of @a size, saving the levels
+	 * in @a workDirectory.
+	 */
+	TablebaseGenerator(QSize size, const QString& workDirectory, int threadCount);
+
+	/**
+	 * Receives progress messages.
+	 */
+	void setLog(std::function<void (const QString&)> log);
+
+	/**
+	 * Generates the tablebase, or continues an interrupted generation, and writes it
+	 * to @a fileName.
+	 * @returns false and sets errorString if a file couldn't be read or written
+	 *          or the board is too large.
+	 */
+	bool run(const QString& fileName);
+
+	QString errorString() const;
+
+private:
+	/**
+	 * A position, see Tablebase. The edges are the visited edges which aren't a part
+	 * of the border, in the order of Board::edgesInside().
+	 */
+	struct State
+	{
+		quint64 edges[Tablebase::wordCount];
+		qint8 x;
+		qint8 y;
+		Player player;
+		quint8 padding[5];
+
+		bool operator <(const State& other) const;
+		bool operator ==(const State& other) const;
+	};
+
+	/**
+	 * A position after one step from a State.
+	 */
+	struct Child
+	{
+		State state;
+
+		/**
+		 * Whether the step ended the game and the player making it won.
+		 */
+		bool over;
+		bool won;
+	};
+
+	bool generateLevels();
+	bool solveLevels();
+	bool writeTablebase(const QString& fileName);
+
+	/**
+	 * Finds the positions after all steps from @a state.
+	 * @returns the number of children written to @a children, at most 8.
+	 */
+	int expand(const State& state, Child* children) const;
+
+	State encode(const Board& board) const;
+	Board decode(const State& state) const;
+
+	/**
+	 * Runs @a f on ranges of [0, count) in all threads and waits for them.
+	 */
+	void parallel(size_t count, std::function<void (size_t begin, size_t end)> f) const;
+
+	QString statesFile(int level) const;
+	QString resultsFile(int level) const;
+
+	template<typename T>
+	bool load(const QString& fileName, std::vector<T>& data);
+
+	template<typename T>
+	bool save(const QString& fileName, const std::vector<T>& data);
+
+	void log(const QString& message) const;
+
+	QSize size;
+	QDir directory;
+	int threadCount;
+	std::function<void (const QString&)> log_;
+	QString errorString_;
+
+	/**
+	 * The edges of the empty board which aren't a part of the border.
+	 */
+	QVector<Edge> edges;
+
+	/**
+	 * The number of levels, the last one is empty.
+	 */
+	int levelCount;
+};
+
+} // namespace ps
+
+#endif // PS_ENGINE_TABLEBASEGENERATOR_HPP
@@ -0,0 +1,116 @@
+#include "transpositiontable.hpp"
+
+namespace ps {
+
+TranspositionTable::TranspositionTable(size_t bytes)
+	: count_(0)
+	, generation_(0)
+{
+	resize(bytes);
+}
+
+void TranspositionTable::resize(size_t bytes)
+{
+	size_t count = 1;
+	while (count * 2 * sizeof(Slot) <= bytes) {
+		count *= 2;
+	}
+
+	if (count == count_) {
+		return;
+	}
+
+	slots_.reset(new Slot[count]);
+	count_ = count;
+	mask_ = count - 1;
+	clear();
+}
+
+int TranspositionTable::size() const
+{
+	return count_;
+}
+
+size_t TranspositionTable::memoryUsage() const
+{
+	return count_ * sizeof(Slot);
+}
+
+void TranspositionTable::clear()
+{
+	// Key 0 is used as "empty", a real position hashing to 0 will just never be found.
+	quint64 data = pack({0, 0, noMove, 0, Exact, 0});
+	for (size_t i = 0; i < count_; i++) {
+		slots_[i].check.store(data, std::memory_order_relaxed);
+		slots_[i].data.store(data, std::memory_order_relaxed);
+	}
+}
+
+void TranspositionTable::newSearch()
+{
+	generation_ = (generation_ + 1) % generationCount;
+}
+
+quint8 TranspositionTable::generation() const
+{
+	return generation_;
+}
+
+Maybe<TranspositionTable::Entry> TranspositionTable::probe(quint64 key) const
+{
+	const Slot& slot = slots_[key & mask_];
+	quint64 data = slot.data.load(std::memory_order_relaxed);
+	quint64 check = slot.check.load(std::memory_order_relaxed);
+	if ((check ^ data) == key && key != 0) {
+		return unpack(key, data);
+	}
+	return none;
+}
+
+void TranspositionTable::store(quint64 key, int depth, Bound bound, int value, int move)
+{
+	Slot& slot = slots_[key & mask_];
+	quint64 oldData = slot.data.load(std::memory_order_relaxed);
+	quint64 oldCheck = slot.check.load(std::memory_order_relaxed);
+	if ((oldCheck ^ oldData) == key && bound != Exact) {
+		Entry old = unpack(key, oldData);
+		if (old.generation == generation_ && old.depth > depth) {
+			return;
+		}
+	}
+
+	Entry entry;
+	entry.key = key;
+	entry.value = value;
+	entry.move = (move >= 0 && move < noMove) ? move : noMove;
+	entry.depth = qBound(-128, depth, 127);
+	entry.bound = bound;
+	entry.generation = generation_;
+
+	quint64 data = pack(entry);
+	slot.check.store(key ^ data, std::memory_order_relaxed);
+	slot.data.store(data, std::memory_order_relaxed);
+}
+
+quint64 TranspositionTable::pack(const Entry& entry)
+{
+	return quint64(quint32(entry.value)) 
+		| quint64(entry.move) << 32 
+		| quint64(quint8(entry.depth)) << 48 
+		| quint64(entry.bound) << 56
+		| quint64(entry.generation) << 58;
+}
+
+TranspositionTable::Entry TranspositionTable::unpack(quint64 key, quint64 data)
+{
+	Entry entry;
+	entry.key = key;
+	entry.value = qint32(quint32(data));
+	entry.move = quint16(data >> 32);
+	entry.depth = qint8(quint8(data >> 48));
+	entry.bound = Bound(quint8(data >> 56) & 3);
+	entry.generation = quint8(data >> 58);
+	return entry;
+}
+
+} // namespace ps
@@ -0,0 +1,143 @@
+#ifndef PS_ENGINE_TRANSPOSITIONTABLE_HPP
+#define PS_ENGINE_TRANSPOSITIONTABLE_HPP
+
+#include "../maybe.hpp"
+
+#include <QtCore/QtGlobal>
+
+#include <atomic>
+#include <memory>
+
+namespace ps {
+
+/**
+ * A fixed-size hash table of search results, indexed by Board::hash().
+ * 
+ * The number of entries is a power of two, a key is mapped to an entry by its low bits.
+ * On a conflict the new result replaces the old one, unless the old one was searched deeper
+ * for the same position.
+ * 
+ * The table can be shared by search threads without locking. An entry is stored as two words, 
+ * the data and the key xor-ed with the data, so an entry torn by concurrent writes doesn't
+ * match any key and is ignored by probe.
+ * 
+ * The table can be kept between searches, entries remember the search (generation) 
+ * that stored them.
+ */
+class TranspositionTable
+{
+public:
+	/**
+	 * How the stored value relates to the real value of the position.
+	 */
+	enum Bound : quint8 {
+		/**
+		 * The value is exact.
+		 */
+		Exact = 0,
+
+		/**
+		 * The real value is at least the stored value (the search failed high).
+		 */
+		Lower = 1,
+
+		/**
+		 * The real value is at most the stored value (the search failed low).
+		 */
+		Upper = 2
+	};
+
+	/**
+	 * Stored move index meaning "no move".
+	 */
+	static const quint16 noMove = 0xffff;
+
+	struct Entry
+	{
+		quint64 key;
+		qint32 value;
+
+		/**
+		 * Index of the best move in enumeration order or noMove.
+		 */
+		quint16 move;
+
+		qint8 depth;
+		Bound bound;
+
+		/**
+		 * The generation of the table when the entry was stored, see newSearch.
+		 */
+		quint8 generation;
+	};
+
+	/**
+	 * The number of distinct generations, they wrap around.
+	 */
+	static const int generationCount = 64;
+
+	/**
+	 * Creates a table using at most @a bytes of memory (but at least one entry).
+	 */
+	explicit TranspositionTable(size_t bytes);
+
+	/**
+	 * Changes the size like the constructor would. The entries are kept if the number
+	 * of entries stays the same, otherwise the table is cleared.
+	 */
+	void resize(size_t bytes);
+
+	/**
+	 * The number of entries.
+	 */
+	int size() const;
+
+	/**
+	 * The memory used by the entries, in bytes.
+	 */
+	size_t memoryUsage() const;
+
+	/**
+	 * Removes all entries.
+	 */
+	void clear();
+
+	/**
+	 * Starts the next generation, entries stored from now on are told apart from 
+	 * the results of previous searches. Don't call while other threads use the table.
+	 */
+	void newSearch();
+	quint8 generation() const;
+
+	/**
+	 * Finds the entry of a position.
+	 */
+	Maybe<Entry> probe(quint64 key) const;
+
+	/**
+	 * Stores a search result. Depth is clamped to the range of the entry and move indices
+	 * that don't fit are stored as noMove. A deeper entry of the position from the current
+	 * generation is kept, unless the result is exact; entries of previous searches are
+	 * always replaced.
+	 */
+	void store(quint64 key, int depth, Bound bound, int value, int move);
+
+private:
+	struct Slot
+	{
+		std::atomic<quint64> check;
+		std::atomic<quint64> data;
+	};
+
+	static quint64 pack(const Entry& entry);
+	static Entry unpack(quint64 key, quint64 data);
+
+	std::unique_ptr<Slot[]> slots_;
+	size_t count_;
+	quint64 mask_;
+	quint8 generation_;
+};
+
+} // namespace ps
+
+#endif // PS_ENGINE_TRANSPOSITIONTABLE_HPP
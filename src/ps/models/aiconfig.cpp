@@ -0,0 +1,256 @@
+#include "aiconfig.hpp"
+
+#include <QtCore/QThread>
+
+namespace ps {
+
+AIConfig::AIConfig()
+	: engine_(Engine::AlphaBeta)
+	, evaluation_(Evaluation::BallRow)
+	, timeLimit_(2000)
+	, depthLimit_(maxDepth)
+	, tableSize_(8)
+	, threadCount_(qBound(1, QThread::idealThreadCount(), maxThreadCount))
+	, playoutLimit_(0)
+	, ponder_(false)
+	, principalVariationSearch_(true)
+	, aspirationWindows_(true)
+	, useBook_(false)
+{
+}
+
+AIConfig::Engine AIConfig::engine() const
+{
+	return engine_;
+}
+
+void AIConfig::setEngine(Engine engine)
+{
+	engine_ = engine;
+}
+
+AIConfig::Evaluation AIConfig::evaluation() const
+{
+	return evaluation_;
+}
+
+void AIConfig::setEvaluation(Evaluation evaluation)
+{
+	evaluation_ = evaluation;
+}
+
+int AIConfig::timeLimit() const
+{
+	return timeLimit_;
+}
+
+void AIConfig::setTimeLimit(int milliseconds)
+{
+	Q_ASSERT(milliseconds >= minTimeLimit && milliseconds <= maxTimeLimit);
+	timeLimit_ = milliseconds;
+}
+
+int AIConfig::depthLimit() const
+{
+	return depthLimit_;
+}
+
+void AIConfig::setDepthLimit(int depth)
+{
+	Q_ASSERT(depth >= 1 && depth <= maxDepth);
+	depthLimit_ = depth;
+}
+
+int AIConfig::tableSize() const
+{
+	return tableSize_;
+}
+
+void AIConfig::setTableSize(int megabytes)
+{
+	Q_ASSERT(megabytes >= 1 && megabytes <= maxTableSize);
+	tableSize_ = megabytes;
+}
+
+int AIConfig::threadCount() const
+{
+	return threadCount_;
+}
+
+void AIConfig::setThreadCount(int count)
+{
+	Q_ASSERT(count >= 1 && count <= maxThreadCount);
+	threadCount_ = count;
+}
+
+int AIConfig::playoutLimit() const
+{
+	return playoutLimit_;
+}
+
+void AIConfig::setPlayoutLimit(int playouts)
+{
+	Q_ASSERT(playouts >= 0 && playouts <= maxPlayoutLimit);
+	playoutLimit_ = playouts;
+}
+
+bool AIConfig::ponder() const
+{
+	return ponder_;
+}
+
+void AIConfig::setPonder(bool ponder)
+{
+	ponder_ = ponder;
+}
+
+bool AIConfig::principalVariationSearch() const
+{
+	return principalVariationSearch_;
+}
+
+void AIConfig::setPrincipalVariationSearch(bool enabled)
+{
+	principalVariationSearch_ = enabled;
+}
+
+bool AIConfig::aspirationWindows() const
+{
+	return aspirationWindows_;
+}
+
+void AIConfig::setAspirationWindows(bool enabled)
+{
+	aspirationWindows_ = enabled;
+}
+
+bool AIConfig::useBook() const
+{
+	return useBook_;
+}
+
+void AIConfig::setUseBook(bool use)
+{
+	useBook_ = use;
+}
+
+QString AIConfig::bookPath() const
+{
+	return bookPath_;
+}
+
+void AIConfig::setBookPath(const QString& path)
+{
+	bookPath_ = path;
+}
+
+bool AIConfig::setOption(const QString& name, const QString& value)
+{
+	static const char* const engines[] = {"alphabeta", "lazysmp", "montecarlo"};
+	static const char* const evaluations[] = {"ballrow", "goaldistance"};
+
+	bool isNumber;
+	int number = value.toInt(&isNumber);
+	if (name == "engine") {
+		for (int i = 0; i < 3; i++) {
+			if (value == engines[i]) {
+				setEngine(static_cast<Engine>(i));
+				return true;
+			}
+		}
+	} else if (name == "evaluation") {
+		for (int i = 0; i < 2; i++) {
+			if (value == evaluations[i]) {
+				setEvaluation(static_cast<Evaluation>(i));
+				return true;
+			}
+		}
+	} else if (name == "time" && isNumber && number >= minTimeLimit && number <= maxTimeLimit) {
+		setTimeLimit(number);
+		return true;
+	} else if (name == "depth" && isNumber && number >= 1 && number <= maxDepth) {
+		setDepthLimit(number);
+		return true;
+	} else if (name == "table" && isNumber && number >= 1 && number <= maxTableSize) {
+		setTableSize(number);
+		return true;
+	} else if (name == "threads" && isNumber && number >= 1 && number <= maxThreadCount) {
+		setThreadCount(number);
+		return true;
+	} else if (name == "playouts" && isNumber && number >= 0 && number <= maxPlayoutLimit) {
+		setPlayoutLimit(number);
+		return true;
+	} else if ((name == "pvs" || name == "aspiration") && (value == "on" || value == "off")) {
+		if (name == "pvs") {
+			setPrincipalVariationSearch(value == "on");
+		} else {
+			setAspirationWindows(value == "on");
+		}
+		return true;
+	} else if (name == "book") {
+		setUseBook(!value.isEmpty());
+		setBookPath(value);
+		return true;
+	}
+	return false;
+}
+
+QDataStream& operator<<(QDataStream& stream, const AIConfig& config)
+{
+	return stream << AIConfig::formatVersion << config.timeLimit_ << config.depthLimit_ << config.tableSize_ 
+		<< config.threadCount_ << static_cast<quint8>(config.engine_) << config.playoutLimit_
+		<< config.ponder_ << static_cast<quint8>(config.evaluation_) << config.useBook_ << config.bookPath_
+		<< config.principalVariationSearch_ << config.aspirationWindows_;
+}
+
+QDataStream& operator>>(QDataStream& stream, AIConfig& config)
+{
+	quint8 version;
+	stream >> version;
+	if (version < 1 || version > AIConfig::formatVersion) {
+		stream.setStatus(QDataStream::ReadCorruptData);
+		return stream;
+	}
+
+	config = AIConfig{};
+	stream >> config.timeLimit_ >> config.depthLimit_ >> config.tableSize_;
+	if (version >= 2) {
+		stream >> config.threadCount_;
+	}
+	quint8 engine = 0;
+	if (version >= 3) {
+		stream >> engine;
+	}
+	config.engine_ = static_cast<AIConfig::Engine>(engine);
+	if (version >= 4) {
+		stream >> config.playoutLimit_;
+	}
+	if (version >= 5) {
+		stream >> config.ponder_;
+	}
+	quint8 evaluation = static_cast<quint8>(config.evaluation_);
+	if (version >= 6) {
+		stream >> evaluation;
+	}
+	config.evaluation_ = static_cast<AIConfig::Evaluation>(evaluation);
+	if (version >= 7) {
+		stream >> config.useBook_ >> config.bookPath_;
+	}
+	if (version >= 8) {
+		stream >> config.principalVariationSearch_ >> config.aspirationWindows_;
+	}
+
+	if (config.timeLimit_ < AIConfig::minTimeLimit || config.timeLimit_ > AIConfig::maxTimeLimit ||
+		config.depthLimit_ < 1 || config.depthLimit_ > AIConfig::maxDepth ||
+		config.tableSize_ < 1 || config.tableSize_ > AIConfig::maxTableSize ||
+		config.threadCount_ < 1 || config.threadCount_ > AIConfig::maxThreadCount ||
+		engine > static_cast<quint8>(AIConfig::Engine::MonteCarlo) ||
+		evaluation > static_cast<quint8>(AIConfig::Evaluation::GoalDistance) ||
+		config.playoutLimit_ < 0 || config.playoutLimit_ > AIConfig::maxPlayoutLimit
+	) {
+		stream.setStatus(QDataStream::ReadCorruptData);
+	}
+	return stream;
+}
+
+} // namespace ps
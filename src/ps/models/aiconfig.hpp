@@ -0,0 +1,176 @@
+#ifndef PS_MODELS_AICONFIG_HPP
+#define PS_MODELS_AICONFIG_HPP
+
+#include <QtCore/QDataStream>
+#include <QtCore/QString>
+
+namespace ps
+{
+
+/**
+ * Settings of the AI of one player, also used for that player's hints.
+ */
+class AIConfig
+{
+public:
+	/**
+	 * The search algorithm.
+	 */
+	enum class Engine : quint8
+	{
+		/**
+		 * Alpha-beta, with the moves of the starting board split between threads.
+		 */
+		AlphaBeta = 0,
+
+		/**
+		 * Alpha-beta, with helper threads running their own searches and sharing 
+		 * the transposition table (Lazy SMP).
+		 */
+		LazySmp = 1,
+
+		/**
+		 * Monte Carlo tree search (UCT) with random playouts.
+		 */
+		MonteCarlo = 2
+	};
+
+	/**
+	 * How the alpha-beta engines score positions at the end of the search.
+	 */
+	enum class Evaluation : quint8
+	{
+		/**
+		 * The row of the ball, the closer to the opponent's goal the better.
+		 */
+		BallRow = 0,
+
+		/**
+		 * The distances to both goals in moves, counting bounces, and the mobility of the player 
+		 * on move (see Board::goalDistances). The row of the ball breaks ties.
+		 */
+		GoalDistance = 1
+	};
+
+	static const int minTimeLimit = 100;
+	static const int maxTimeLimit = 600000;
+	static const int maxDepth = 100;
+	static const int maxTableSize = 4096;
+	static const int maxThreadCount = 256;
+	static const int maxPlayoutLimit = 100000000;
+
+	AIConfig();
+	AIConfig(const AIConfig&) = default;
+	AIConfig(AIConfig&&) = default;
+	AIConfig& operator =(const AIConfig&) = default;
+	AIConfig& operator =(AIConfig&&) = default;
+
+	Engine engine() const;
+	void setEngine(Engine engine);
+
+	Evaluation evaluation() const;
+	void setEvaluation(Evaluation evaluation);
+
+	/**
+	 * The time the AI may think about one move, in milliseconds.
+	 */
+	int timeLimit() const;
+	void setTimeLimit(int milliseconds);
+
+	/**
+	 * The search stops after this depth (in steps), even if there is time left.
+	 */
+	int depthLimit() const;
+	void setDepthLimit(int depth);
+
+	/**
+	 * The memory budget of the transposition table, in megabytes.
+	 */
+	int tableSize() const;
+	void setTableSize(int megabytes);
+
+	/**
+	 * The number of threads searching in parallel, by default one per core.
+	 */
+	int threadCount() const;
+	void setThreadCount(int count);
+
+	/**
+	 * The number of playouts after which the Monte Carlo engine stops, 0 if only the time 
+	 * limit applies. Playouts reused from the previous search count too.
+	 */
+	int playoutLimit() const;
+	void setPlayoutLimit(int playouts);
+
+	/**
+	 * Whether the AI keeps searching while a human opponent thinks about the move (pondering), 
+	 * so that the reply takes less time.
+	 */
+	bool ponder() const;
+	void setPonder(bool ponder);
+
+	/**
+	 * Whether the alpha-beta engines search the moves after the first one with a null window
+	 * (principal variation search), searching a move again only if it turns out better.
+	 */
+	bool principalVariationSearch() const;
+	void setPrincipalVariationSearch(bool enabled);
+
+	/**
+	 * Whether the iterations of the alpha-beta engines start with a narrow window around
+	 * the value of the previous iteration (aspiration windows), widening it if the value 
+	 * falls outside.
+	 */
+	bool aspirationWindows() const;
+	void setAspirationWindows(bool enabled);
+
+	/**
+	 * Whether the AI plays the moves of the opening book at bookPath() while the game 
+	 * is in the book, without searching.
+	 */
+	bool useBook() const;
+	void setUseBook(bool use);
+
+	/**
+	 * The opening book file, see OpeningBook.
+	 */
+	QString bookPath() const;
+	void setBookPath(const QString& path);
+
+	/**
+	 * Sets an option by name, for the text interfaces of the tools: engine (alphabeta, lazysmp, 
+	 * montecarlo), evaluation (ballrow, goaldistance), time, depth, table, threads, playouts,
+	 * pvs and aspiration (on, off) and book (a path, empty to play without the book).
+	 * @returns false if the name or the value is invalid, the config isn't changed then.
+	 */
+	bool setOption(const QString& name, const QString& value);
+
+private:
+	friend QDataStream& operator <<(QDataStream& stream, const AIConfig& config);
+	friend QDataStream& operator >>(QDataStream& stream, AIConfig& config);
+
+	/**
+	 * Incremented when fields are added, older versions are loaded with defaults for the new fields.
+	 */
+	static const quint8 formatVersion = 8;
+
+	Engine engine_;
+	Evaluation evaluation_;
+	int timeLimit_;
+	int depthLimit_;
+	int tableSize_;
+	int threadCount_;
+	int playoutLimit_;
+	bool ponder_;
+	bool principalVariationSearch_;
+	bool aspirationWindows_;
+	bool useBook_;
+	QString bookPath_;
+};
+
+QDataStream& operator <<(QDataStream& stream, const AIConfig& config);
+QDataStream& operator >>(QDataStream& stream, AIConfig& config);
+
+} // namespace ps
+
+#endif // PS_MODELS_AICONFIG_HPP
@@ -1,7 +1,123 @@
 #include "board.hpp"
 
+#include <QtCore/QtAlgorithms>
+#include <QtCore/QMutex>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
 namespace ps {
 
+namespace {
+
+/**
+ * The number of set bits in every possible edge mask.
+ */
+struct BitCounts
+{
+	BitCounts()
+	{
+		for (int mask = 0; mask < 256; ++mask) {
+			counts[mask] = qPopulationCount(static_cast<quint8>(mask));
+		}
+	}
+
+	quint8 counts[256];
+};
+
+const BitCounts bitCounts;
+
+} // namespace
+
+struct Board::Layout
+{
+	/**
+	 * Difference of point indices between two points connected by an edge in the given direction.
+	 */
+	int offsets[8];
+
+	/**
+	 * The number of points in the bounding box of the board, the size of the edge masks.
+	 */
+	int pointCount;
+
+	/**
+	 * The size of the step stack, the number of edges inside the board.
+	 */
+	int stepCapacity;
+
+	/**
+	 * Per-point masks of edges inside the board.
+	 */
+	quint8 inside[maxPoints];
+
+	/**
+	 * Per-point players winning when the ball gets to the point, -1 outside the goals.
+	 */
+	qint8 goals[maxPoints];
+
+	/**
+	 * All edges inside the board, normalized.
+	 */
+	QVector<Edge> edges;
+};
+
+struct Board::ZobristKeys
+{
+	/**
+	 * Fills the keys from a fixed seed, so that hashes are the same in every run.
+	 */
+	ZobristKeys()
+	{
+		// SplitMix64.
+		quint64 state = 0x5061706572536f63ull;
+		auto next = [&state] () {
+			quint64 z = (state += 0x9e3779b97f4a7c15ull);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+			return z ^ (z >> 31);
+		};
+
+		for (int i = 0; i < 4 * maxPoints; ++i) {
+			oldEdges[i] = next();
+			newEdges[i] = next();
+		}
+		for (int i = 0; i < maxPoints; ++i) {
+			ball[i] = next();
+		}
+		for (int w = 0; w <= maxSize / 2; ++w) {
+			for (int h = 0; h <= maxSize / 2 + 1; ++h) {
+				size[w][h] = next();
+			}
+		}
+		playerTwo = next();
+		for (int i = 0; i < 4 * maxPoints; ++i) {
+			borderEdges[i] = next();
+		}
+	}
+
+	/**
+	 * Keys of normalized edges, indexed by 4 * (start point index) + direction.
+	 */
+	//@{
+	quint64 oldEdges[4 * maxPoints];
+	quint64 newEdges[4 * maxPoints];
+	quint64 borderEdges[4 * maxPoints];
+	//@}
+
+	quint64 ball[maxPoints];
+
+	/**
+	 * Keys of board sizes (including gates), indexed by the half width and half height.
+	 */
+	quint64 size[maxSize / 2 + 1][maxSize / 2 + 2];
+
+	quint64 playerTwo;
+};
+
+const Board::ZobristKeys Board::zobristKeys;
+
 Player operator!(Player p)
 {
 	switch (p) {
@@ -51,22 +167,21 @@ QDataStream& operator >>(QDataStream& stream, EdgeCategory& cat)
 }
 
 Board::Board()
-	: size_(0, 0)
-	, ball_(0, 0)
-	, shape(intervals())
-	, currentPlayer_(Player::One)
+	: layout_(nullptr)
+	, largeCapacity_(0)
 {
+	reset({0, 0});
 }
 
 Board::Board(QSize size)
-	: size_(size.width(), size.height() + 2) // add the gates
-	, ball_(0, 0)
-	, shape(intervals())
-	, edges(shape.size(), EdgeCategory::Empty)
-	, currentPlayer_(Player::One)
+	: layout_(nullptr)
+	, largeCapacity_(0)
 {
-	Q_ASSERT(width() % 2 == 0);
-	Q_ASSERT(height() % 2 == 0);
+	Q_ASSERT(size.width() % 2 == 0);
+	Q_ASSERT(size.height() % 2 == 0);
+	Q_ASSERT(size.width() <= maxSize && size.height() <= maxSize);
+
+	reset({size.width(), size.height() + 2}); // add the gates
 
 	// 012.....halfWidth()
 	// -
@@ -106,6 +221,76 @@ Board::Board(QSize size)
 	setEdgeCategory({{-1, -hh}, North}, EdgeCategory::Border);
 }
 
+Board::Board(const Board& board)
+	: layout_(nullptr)
+	, largeCapacity_(0)
+{
+	*this = board;
+}
+
+Board::Board(Board&& board)
+	: layout_(nullptr)
+	, largeCapacity_(0)
+{
+	*this = std::move(board);
+}
+
+Board& Board::operator =(const Board& board)
+{
+	if (this == &board) {
+		return *this;
+	}
+
+	size_ = board.size_;
+	if (layout_ != board.layout_) {
+		layout_ = board.layout_;
+		allocateMasks();
+		steps_.reset();
+	}
+	ball_ = board.ball_;
+	ballIndex_ = board.ballIndex_;
+	currentPlayer_ = board.currentPlayer_;
+	hash_ = board.hash_;
+	memcpy(visited_, board.visited_, 3 * layout_->pointCount);
+
+	Move move = board.currentMove();
+	if (!move.empty() && steps_ == nullptr) {
+		steps_.reset(new Direction[layout_->stepCapacity]);
+	}
+	std::copy(move.begin(), move.end(), steps_.get());
+	moveStart_ = 0;
+	stepCount_ = move.size();
+	return *this;
+}
+
+Board& Board::operator =(Board&& board)
+{
+	// Only the allocated masks are worth taking over, small boards are just copied.
+	if (this == &board || board.largeMasks_ == nullptr) {
+		return *this = static_cast<const Board&>(board);
+	}
+
+	size_ = board.size_;
+	layout_ = board.layout_;
+	ball_ = board.ball_;
+	ballIndex_ = board.ballIndex_;
+	currentPlayer_ = board.currentPlayer_;
+	hash_ = board.hash_;
+	largeMasks_ = std::move(board.largeMasks_);
+	largeCapacity_ = board.largeCapacity_;
+	allocateMasks();
+
+	steps_ = std::move(board.steps_);
+	stepCount_ = board.stepCount_ - board.moveStart_;
+	moveStart_ = 0;
+	if (stepCount_ > 0) {
+		std::copy(steps_.get() + board.moveStart_, steps_.get() + board.stepCount_, steps_.get());
+	}
+
+	board.reset({0, 0});
+	return *this;
+}
+
 QSize Board::size() const
 {
 	return size_;
@@ -139,7 +324,10 @@ QPoint Board::ball() const
 void Board::setBall(QPoint ball)
 {
 	Q_ASSERT(isPointInside(ball));
+	hash_ ^= zobristKeys.ball[ballIndex_];
 	ball_ = ball;
+	ballIndex_ = pointIndex(ball);
+	hash_ ^= zobristKeys.ball[ballIndex_];
 }
 
 bool Board::isPointInside(QPoint point) const
@@ -168,29 +356,50 @@ QVector<QPoint> Board::pointsInside() const
 
 int Board::countVisitedEdgesAround(QPoint point) const
 {
-	int count = 0;
-	for (Direction dir : directions) {
-		Edge edge{point, dir};
-		if (isEdgeVisited(edge)) {
-			++count;
-		}
+	if (!isPointInside(point)) {
+		return 0;
 	}
-	return count;
+	return visitedCount(pointIndex(point));
 }
 
 EdgeCategory Board::edgeCategory(Edge edge) const
 {
 	Q_ASSERT(isEdgeInside(edge));
-	return edges[edgeIndex(edge)];
+	int index = pointIndex(edge.start());
+	quint8 bit = 1 << edge.direction();
+
+	if (!(visited_[index] & bit)) {
+		return EdgeCategory::Empty;
+	} else if (border_[index] & bit) {
+		return EdgeCategory::Border;
+	} else if (new_[index] & bit) {
+		return EdgeCategory::New;
+	} else {
+		return EdgeCategory::Old;
+	}
 }
 
 void Board::setEdgeCategory(Edge edge, EdgeCategory category)
 {
 	Q_ASSERT(isEdgeInside(edge));
-	edges[edgeIndex(edge)] = category;
+	int start = pointIndex(edge.start());
+	int end = start + layout_->offsets[edge.direction()];
+	hashEdge(start, end, edge.direction(), edgeCategory(edge));
+	hashEdge(start, end, edge.direction(), category);
+	setEdgeBits(visited_, start, end, edge.direction(), category != EdgeCategory::Empty);
+	setEdgeBits(border_, start, end, edge.direction(), category == EdgeCategory::Border);
+	setEdgeBits(new_, start, end, edge.direction(), category == EdgeCategory::New);
 }
 
 bool Board::isEdgeInside(Edge edge) const
+{
+	if (!isPointInside(edge.start())) {
+		return false;
+	}
+	return layout_->inside[pointIndex(edge.start())] & (1 << edge.direction());
+}
+
+bool Board::computeEdgeInside(Edge edge) const
 {
 	edge.normalize();
 
@@ -217,21 +426,12 @@ bool Board::isEdgeInside(Edge edge) const
 
 bool Board::isEdgeVisited(Edge edge) const
 {
-	return isEdgeInside(edge) && edgeCategory(edge) != EdgeCategory::Empty;
+	return isEdgeInside(edge) && (visited_[pointIndex(edge.start())] & (1 << edge.direction()));
 }
 
-QVector<Edge> Board::edgesInside() const
+const QVector<Edge>& Board::edgesInside() const
 {
-	QVector<Edge> edges;
-	for (QPoint p : pointsInside()) {
-		for (Direction dir : directions) {
-			Edge edge{p, dir};
-			if (isEdgeInside(edge)) {
-				edges.push_back(edge);
-			}
-		}
-	}
-	return edges;
+	return layout_->edges;
 }
 
 Player Board::currentPlayer() const
@@ -239,14 +439,22 @@ Player Board::currentPlayer() const
 	return currentPlayer_;
 }
 
+quint64 Board::hash() const
+{
+	return hash_;
+}
+
 void Board::setCurrentPlayer(Player player)
 {
+	if (player != currentPlayer_) {
+		hash_ ^= zobristKeys.playerTwo;
+	}
 	currentPlayer_ = player;
 }
 
-const QVector<Direction>& Board::currentMove() const
+Move Board::currentMove() const
 {
-	return currentMove_;
+	return {steps_.get() + moveStart_, stepCount_ - moveStart_};
 }
 
 void Board::setCurrentMove(const QVector<Direction>& move)
@@ -259,7 +467,7 @@ void Board::setCurrentMove(const QVector<Direction>& move)
 
 void Board::clearCurrentMove()
 {
-	while (!currentMove_.empty()) {
+	while (stepCount_ > moveStart_) {
 		popStep();
 	}
 }
@@ -267,31 +475,45 @@ void Board::clearCurrentMove()
 void Board::pushStep(Direction dir)
 {
 	Q_ASSERT(canStepInDirection(dir));
-	Edge edge{ball(), dir};
-	setEdgeCategory(edge, EdgeCategory::New);
-	currentMove_.push_back(dir);
-	setBall(edge.end());
+	int start = ballIndex_;
+	int end = start + layout_->offsets[dir];
+	setEdgeBits(visited_, start, end, dir, true);
+	setEdgeBits(new_, start, end, dir, true);
+	hashEdge(start, end, dir, EdgeCategory::New);
+	hash_ ^= zobristKeys.ball[start] ^ zobristKeys.ball[end];
+	if (steps_ == nullptr) {
+		steps_.reset(new Direction[layout_->stepCapacity]);
+	}
+	Q_ASSERT(stepCount_ < layout_->stepCapacity);
+	steps_[stepCount_++] = dir;
+	ball_ += dirToPoint(dir);
+	ballIndex_ = end;
 }
 
 void Board::popStep()
 {
-	Direction dir = currentMove_.back();
-	currentMove_.pop_back();
+	Q_ASSERT(stepCount_ > moveStart_);
+	Direction dir = steps_[--stepCount_];
 
-	Edge edge{ball(), opposite(dir)};
-	Q_ASSERT(isEdgeInside(edge));
-	Q_ASSERT(edgeCategory(edge) == EdgeCategory::New);
+	Q_ASSERT(isEdgeInside({ball(), opposite(dir)}));
+	Q_ASSERT(edgeCategory({ball(), opposite(dir)}) == EdgeCategory::New);
 
-	setEdgeCategory(edge, EdgeCategory::Empty);
-	setBall(edge.end());
+	int end = ballIndex_;
+	int start = end - layout_->offsets[dir];
+	setEdgeBits(visited_, start, end, dir, false);
+	setEdgeBits(new_, start, end, dir, false);
+	hashEdge(start, end, dir, EdgeCategory::New);
+	hash_ ^= zobristKeys.ball[start] ^ zobristKeys.ball[end];
+	ball_ += dirToPoint(opposite(dir));
+	ballIndex_ = start;
 }
 
 bool Board::canFinishMove() const
 {
-	if (currentMove_.empty())
+	if (stepCount_ == moveStart_)
 		return false;
 	
-	if (countVisitedEdgesAround(ball()) > 1)
+	if (visitedCount(ballIndex_) > 1)
 		return false;
 	
 	return true;
@@ -303,8 +525,7 @@ bool Board::canStepInDirection(Direction dir) const
 		return false;
 	}
 	
-	Edge edge{ball(), dir};
-	return isEdgeInside(edge) && !isEdgeVisited(edge);
+	return freeDirections() & (1 << dir);
 }
 
 bool Board::canStepTo(QPoint point) const
@@ -317,30 +538,27 @@ bool Board::canStepTo(QPoint point) const
 
 bool Board::canPushSomeStep() const
 {
-	for (Direction dir : directions) {
-		if (canStepInDirection(dir)) {
-			return true;
-		}
+	if (canFinishMove()) {
+		return false;
 	}
-	return false;
+
+	return freeDirections() != 0;
 }
 
-QVector<Direction> Board::convertCurrentMoveToOldEdges()
+quint8 Board::stepDirections() const
 {
-	QPoint p = ball();
-	for (int i = currentMove_.size() - 1; i >= 0; --i) {
-		Direction dir = currentMove_[i];
-
-		Edge edge{p, opposite(dir)};
-		Q_ASSERT(isEdgeInside(edge));
-		Q_ASSERT(edgeCategory(edge) == EdgeCategory::New);
-		setEdgeCategory(edge, EdgeCategory::Old);
-
-		p = edge.end();
+	if (canFinishMove()) {
+		return 0;
 	}
 
-	QVector<Direction> move;
-	move.swap(currentMove_);
+	return freeDirections();
+}
+
+QVector<Direction> Board::convertCurrentMoveToOldEdges()
+{
+	QVector<Direction> move = currentMove().toVector();
+	markCurrentMoveNew(false);
+	stepCount_ = moveStart_;
 	return move;
 }
 
@@ -353,50 +571,74 @@ QVector<Direction> Board::finishMove()
 	return move;
 }
 
-void Board::undoConvertCurrentMoveToOldEdges(QVector<Direction>&& move)
+void Board::endMove()
 {
-	currentMove_ = std::move(move);
-	QPoint p = ball();
-	for (int i = currentMove_.size() - 1; i >= 0; --i) {
-		Direction dir = currentMove_[i];
+	Q_ASSERT(canFinishMove());
+	Q_ASSERT(winner().isNone());
+	markCurrentMoveNew(false);
+	stepCount_ = moveStart_;
+	setCurrentPlayer(!currentPlayer());
+}
 
-		Edge edge{p, opposite(dir)};
-		Q_ASSERT(isEdgeInside(edge));
-		Q_ASSERT(edgeCategory(edge) == EdgeCategory::Old);
-		setEdgeCategory(edge, EdgeCategory::New);
+int Board::pushFinishedMove()
+{
+	Q_ASSERT(canFinishMove());
+	Q_ASSERT(winner().isNone());
+	markCurrentMoveNew(false);
+	setCurrentPlayer(!currentPlayer());
 
-		p = edge.end();
-	}
+	int moveStart = moveStart_;
+	moveStart_ = stepCount_;
+	return moveStart;
 }
 
-void Board::undoFinishMove(QVector<Direction>&& move)
+void Board::popFinishedMove(int moveStart)
 {
-	undoConvertCurrentMoveToOldEdges(std::move(move));
+	Q_ASSERT(stepCount_ == moveStart_);
+	moveStart_ = moveStart;
+	markCurrentMoveNew(true);
 	setCurrentPlayer(!currentPlayer());
 }
 
-bool Board::enumerateMoves(std::function<bool (Board&, const QVector<Direction>&)> callback)
+int Board::pushMove(Move steps)
 {
-	if (winner().isSome()) {
-		return callback(*this, currentMove());
-	} else if (canFinishMove()) {
-		QVector<Direction> move = finishMove();
-		bool cont = callback(*this, move);
-		undoFinishMove(std::move(move));
-		return cont;
-	} else {
-		for (Direction dir : directions) {
-			if (canStepInDirection(dir)) {
-				pushStep(dir);
-				bool cont = enumerateMoves(callback);
-				popStep();
-				if (!cont) {
-					return false;
-				}
-			}
-		}
+	for (Direction dir : steps) {
+		pushStep(dir);
 	}
-	return true;
+	if (winner().isSome() || !canFinishMove()) {
+		return -1;
+	}
+	return pushFinishedMove();
+}
+
+void Board::popMove(int token, int stepCount)
+{
+	if (token >= 0) {
+		popFinishedMove(token);
+	}
+	for (int i = 0; i < stepCount; i++) {
+		popStep();
+	}
+}
+
+void Board::markCurrentMoveNew(bool isNew)
+{
+	int end = ballIndex_;
+	for (int i = stepCount_ - 1; i >= moveStart_; --i) {
+		Direction dir = steps_[i];
+		int start = end - layout_->offsets[dir];
+		setEdgeBits(new_, start, end, dir, isNew);
+		hashEdge(start, end, dir, EdgeCategory::Old);
+		hashEdge(start, end, dir, EdgeCategory::New);
+		end = start;
+	}
+}
+
+bool Board::enumerateMoves(std::function<bool (Board&, const QVector<Direction>&)> callback)
+{
+	return enumerateMoves([&callback] (Board& board, Move move) {
+		return callback(board, move.toVector());
+	});
 }
 
 Maybe<Player> Board::winner() const
@@ -405,13 +647,96 @@ Maybe<Player> Board::winner() const
 		return Player::Two;
 	} else if (ball().y() == -halfHeight()) {
 		return Player::One;
-	} if (!canFinishMove() && !canPushSomeStep()) {
+	} if (!canFinishMove() && freeDirections() == 0) {
 		return !currentPlayer();
 	} else {
 		return none;
 	}
 }
 
+Board::GoalDistances Board::goalDistances(int limit) const
+{
+	Q_ASSERT(limit >= 0 && limit < 255);
+
+	GoalDistances result;
+	result.goal[0] = limit + 1;
+	result.goal[1] = limit + 1;
+	result.reachable = 0;
+
+	// A breadth first search by distance: points of the same distance are found by a flood 
+	// over bounces from the points queued for that distance.
+	// The buffers are sized like the edge masks: on the stack for small boards.
+	int count = layout_->pointCount;
+	quint8 smallDistance[smallPoints];
+	quint16 smallQueues[3 * smallPoints];
+	std::unique_ptr<quint8[]> largeDistance;
+	std::unique_ptr<quint16[]> largeQueues;
+	quint8* distance = smallDistance;
+	quint16* queues = smallQueues;
+	if (count > smallPoints) {
+		largeDistance.reset(new quint8[count]);
+		largeQueues.reset(new quint16[3 * count]);
+		distance = largeDistance.get();
+		queues = largeQueues.get();
+	}
+	memset(distance, 0xff, count);
+	quint16* level = queues;
+	quint16* next = queues + count;
+	quint16* stack = queues + 2 * count;
+	int levelSize = 0;
+	int nextSize = 0;
+	int found = 0;
+
+	distance[ballIndex_] = 0;
+	level[levelSize++] = ballIndex_;
+	for (int d = 0; d <= limit && levelSize > 0 && found < 2; d++) {
+		// Points lowered to a smaller distance in the meantime were already searched.
+		int stackSize = 0;
+		for (int i = 0; i < levelSize; i++) {
+			if (distance[level[i]] == d) {
+				stack[stackSize++] = level[i];
+			}
+		}
+
+		while (stackSize > 0) {
+			int index = stack[--stackSize];
+			if (d == 0) {
+				result.reachable++;
+			}
+
+			// The game ends in a goal.
+			int goal = layout_->goals[index];
+			if (goal >= 0) {
+				if (result.goal[goal] > limit) {
+					result.goal[goal] = d;
+					found++;
+				}
+				continue;
+			}
+
+			for (quint8 free = layout_->inside[index] & ~visited_[index]; free != 0; free &= free - 1) {
+				int target = index + layout_->offsets[qCountTrailingZeroBits(free)];
+				bool bounce = visited_[target] != 0 || layout_->goals[target] >= 0;
+				int targetDistance = bounce ? d : d + 1;
+				if (targetDistance < distance[target]) {
+					distance[target] = targetDistance;
+					if (bounce) {
+						stack[stackSize++] = target;
+					} else {
+						next[nextSize++] = target;
+					}
+				}
+			}
+		}
+
+		std::copy(next, next + nextSize, level);
+		levelSize = nextSize;
+		nextSize = 0;
+	}
+
+	return result;
+}
+
 Shape<int, int, quint8>::IntervalsTuple Board::intervals() const
 {
 	return std::make_tuple(
@@ -421,27 +746,169 @@ Shape<int, int, quint8>::IntervalsTuple Board::intervals() const
 	);
 }
 
-int Board::edgeIndex(Edge edge) const
+const Board::Layout* Board::findLayout() const
 {
-	edge.normalize();
-	return shape.map(std::make_tuple(
-		edge.start().x(), 
-		edge.start().y(), 
-		static_cast<quint8>(edge.direction())
-	));
+	// Sizes (including gates) are even and bounded, so the layouts fit in a small table.
+	// A layout never changes once published, so only building one takes the lock.
+	static QMutex mutex;
+	static std::atomic<const Layout*> layouts[maxSize / 2 + 1][maxSize / 2 + 2];
+
+	std::atomic<const Layout*>& layout = layouts[halfWidth()][halfHeight()];
+	const Layout* existing = layout.load(std::memory_order_acquire);
+	if (existing != nullptr) {
+		return existing;
+	}
+
+	QMutexLocker locker(&mutex);
+	existing = layout.load(std::memory_order_relaxed);
+	if (existing != nullptr) {
+		return existing;
+	}
+
+	// Layouts are never freed, there is at most one per board size.
+	Layout* newLayout = new Layout;
+
+	int stride = width() + 1;
+	newLayout->pointCount = stride * (height() + 1);
+	for (Direction dir : directions) {
+		QPoint diff = dirToPoint(dir);
+		newLayout->offsets[dir] = diff.x() + diff.y() * stride;
+	}
+
+	memset(newLayout->inside, 0, sizeof(newLayout->inside));
+	for (QPoint p : pointsInside()) {
+		for (Direction dir : directions) {
+			Edge edge{p, dir};
+			if (computeEdgeInside(edge)) {
+				newLayout->inside[pointIndex(p)] |= 1 << dir;
+				// Every edge is seen from both ends, keep the normalized one.
+				if (static_cast<quint8>(dir) < 4) {
+					newLayout->edges.push_back(edge);
+				}
+			}
+		}
+	}
+
+	newLayout->stepCapacity = qMax(1, newLayout->edges.size());
+
+	memset(newLayout->goals, -1, sizeof(newLayout->goals));
+	for (int x = -1; x <= 1; ++x) {
+		if (isPointInside({x, halfHeight()})) {
+			newLayout->goals[pointIndex({x, -halfHeight()})] = static_cast<qint8>(Player::One);
+			newLayout->goals[pointIndex({x, halfHeight()})] = static_cast<qint8>(Player::Two);
+		}
+	}
+
+	layout.store(newLayout, std::memory_order_release);
+	return newLayout;
+}
+
+void Board::reset(QSize size)
+{
+	size_ = size;
+	const Layout* layout = findLayout();
+	if (layout != layout_) {
+		layout_ = layout;
+		allocateMasks();
+		steps_.reset();
+	}
+	memset(visited_, 0, 3 * layout_->pointCount);
+
+	ball_ = {0, 0};
+	ballIndex_ = pointIndex(ball_);
+	currentPlayer_ = Player::One;
+	hash_ = zobristKeys.size[halfWidth()][halfHeight()] ^ zobristKeys.ball[ballIndex_];
+	moveStart_ = 0;
+	stepCount_ = 0;
+}
+
+void Board::allocateMasks()
+{
+	int count = layout_->pointCount;
+	quint8* masks = smallMasks_;
+	if (count > smallPoints) {
+		// The masks of a smaller board can't be reused for a larger one.
+		if (largeMasks_ == nullptr || largeCapacity_ < count) {
+			largeMasks_.reset(new quint8[3 * count]);
+			largeCapacity_ = count;
+		}
+		masks = largeMasks_.get();
+	} else {
+		largeMasks_.reset();
+		largeCapacity_ = 0;
+	}
+	visited_ = masks;
+	border_ = masks + count;
+	new_ = masks + 2 * count;
+}
+
+int Board::pointIndex(QPoint point) const
+{
+	Q_ASSERT(abs(point.x()) <= halfWidth() && abs(point.y()) <= halfHeight());
+	return (point.x() + halfWidth()) + (point.y() + halfHeight()) * (width() + 1);
+}
+
+int Board::visitedCount(int index) const
+{
+	return bitCounts.counts[visited_[index]];
+}
+
+quint8 Board::freeDirections() const
+{
+	return layout_->inside[ballIndex_] & ~visited_[ballIndex_];
+}
+
+void Board::hashEdge(int start, int end, Direction dir, EdgeCategory category)
+{
+	int index = dir < 4 ? 4 * start + dir : 4 * end + opposite(dir);
+	if (category == EdgeCategory::Old) {
+		hash_ ^= zobristKeys.oldEdges[index];
+	} else if (category == EdgeCategory::New) {
+		hash_ ^= zobristKeys.newEdges[index];
+	} else if (category == EdgeCategory::Border) {
+		hash_ ^= zobristKeys.borderEdges[index];
+	}
+}
+
+void Board::setEdgeBits(quint8* masks, int start, int end, Direction dir, bool on)
+{
+	quint8 startBit = 1 << dir;
+	quint8 endBit = 1 << opposite(dir);
+	if (on) {
+		masks[start] |= startBit;
+		masks[end] |= endBit;
+	} else {
+		masks[start] &= ~startBit;
+		masks[end] &= ~endBit;
+	}
 }
 
 QDataStream& operator<<(QDataStream& stream, const Board& board)
 {
-	return stream << board.size_ << board.ball_ << board.edges << board.currentPlayer_ << board.currentMove_;
+	// The edges are saved as a flat vector of categories indexed by the shape, so that
+	// the format doesn't depend on the in-memory representation.
+	Shape<int, int, quint8> shape(board.intervals());
+	QVector<EdgeCategory> edges(shape.size(), EdgeCategory::Empty);
+	for (QPoint p : board.pointsInside()) {
+		for (quint8 dir = 0; dir < 4; ++dir) {
+			Edge edge{p, static_cast<Direction>(dir)};
+			if (board.isEdgeInside(edge)) {
+				edges[shape.map(std::make_tuple(p.x(), p.y(), dir))] = board.edgeCategory(edge);
+			}
+		}
+	}
+
+	return stream << board.size_ << board.ball_ << edges << board.currentPlayer_ << board.currentMove().toVector();
 }
 
 QDataStream& operator>>(QDataStream& stream, Board& board)
 {
-	board.edges.clear();
-	board.currentMove_.clear();
-	stream >> board.size_ >> board.ball_ >> board.edges >> board.currentPlayer_ >> board.currentMove_;
-	board.shape.setIntervals(board.intervals());
+	QSize size;
+	QPoint ball;
+	QVector<EdgeCategory> edges;
+	Player currentPlayer = Player::One;
+	QVector<Direction> currentMove;
+	stream >> size >> ball >> edges >> currentPlayer >> currentMove;
 
 	// Check data integrity.
 	// This doesn't check if currentMove doesn't get out of the board and if edge categories are ok.
@@ -450,15 +917,41 @@ QDataStream& operator>>(QDataStream& stream, Board& board)
 	// crash the program - QVector is saved like this: <item count><item 0><item 1>...
 	// Just set item count to MAX_INT and the program will (probably) run OOM when loading that vector.
 	// So this function really isn't critical. QDataStream in itself is very fragile...
-	if (board.size().width() < 2 || board.size().height() < 2 ||
-		board.size().width() % 2 != 0 || board.size().height() % 2 != 0 ||
-		(size_t)board.edges.size() != board.shape.size() ||
-		!board.isPointInside(board.ball())
+	if (size.width() < 2 || size.height() < 2 ||
+		size.width() % 2 != 0 || size.height() % 2 != 0 ||
+		size.width() > Board::maxSize || size.height() > Board::maxSize + 2
 	) {
 		stream.setStatus(QDataStream::ReadCorruptData);
 		return stream;
 	}
 
+	board.reset(size);
+	Shape<int, int, quint8> shape(board.intervals());
+	if ((size_t)edges.size() != shape.size() || !board.isPointInside(ball)) {
+		stream.setStatus(QDataStream::ReadCorruptData);
+		return stream;
+	}
+
+	for (QPoint p : board.pointsInside()) {
+		for (quint8 dir = 0; dir < 4; ++dir) {
+			Edge edge{p, static_cast<Direction>(dir)};
+			if (board.isEdgeInside(edge)) {
+				board.setEdgeCategory(edge, edges[shape.map(std::make_tuple(p.x(), p.y(), dir))]);
+			}
+		}
+	}
+	board.setBall(ball);
+	board.setCurrentPlayer(currentPlayer);
+	if (currentMove.size() > board.layout_->stepCapacity) {
+		stream.setStatus(QDataStream::ReadCorruptData);
+		return stream;
+	}
+	if (board.steps_ == nullptr) {
+		board.steps_.reset(new Direction[board.layout_->stepCapacity]);
+	}
+	std::copy(currentMove.begin(), currentMove.end(), board.steps_.get());
+	board.stepCount_ = currentMove.size();
+
 	return stream;
 }
 
@@ -5,15 +5,16 @@
 #include "../shape.hpp"
 #include "direction.hpp"
 #include "edge.hpp"
+#include "move.hpp"
 
 #include <QtCore/QVector>
 #include <QtCore/QPoint>
 #include <QtCore/QSize>
 #include <QtCore/QDataStream>
 
-namespace ps {
+#include <memory>
 
-class Move;
+namespace ps {
 
 enum class Player : quint8
 {
@@ -62,10 +63,19 @@ QDataStream& operator >>(QDataStream& stream, EdgeCategory& cat);
  *     - current player,
  *     - edge types,
  *     - the current players partial move.
+ * 
+ * Edges are stored as bit masks kept for every point of the board, bit i of a mask
+ * describes the edge going from that point in direction i. Every edge is stored twice,
+ * once in each of its end points, so the edges around a point can be read at once.
  */
 class Board
 {
 public:
+	/**
+	 * The maximal width and height of a board (excluding gates).
+	 */
+	static const int maxSize = 30;
+
 	/**
 	 * Initializes an empty board, with no edges at all and size 0x0.
 	 */
@@ -74,14 +84,21 @@ public:
 	/**
 	 * Initializes an empty board, with the ball on the center.
 	 * 
-	 * @param size The size of the board excluding gates. Both width and height must be even.
+	 * @param size The size of the board excluding gates. Both width and height must be even
+	 *             and not greater than maxSize.
 	 */
 	Board(QSize size);
 
-	Board(const Board&) = default;
-	Board(Board&&) = default;
-	Board& operator =(const Board&) = default;
-	Board& operator =(Board&&) = default;
+	/**
+	 * Copies the position and the current move. Moves finished by enumerateMoves
+	 * are a part of the position, but the copy can't pop them.
+	 */
+	//@{
+	Board(const Board& board);
+	Board(Board&& board);
+	Board& operator =(const Board& board);
+	Board& operator =(Board&& board);
+	//@}
 
 	// Board size.
 
@@ -126,9 +143,20 @@ public:
 	bool isEdgeVisited(Edge edge) const;
 
 	/**
-	 * @returns a vector of all visited edges.
+	 * @returns a vector of all edges inside the board, each edge is listed once (normalized).
+	 * The vector is shared by all boards of the same size.
+	 */
+	const QVector<Edge>& edgesInside() const;
+
+	// Hashing.
+
+	/**
+	 * A 64-bit Zobrist key of the position: edges, ball, current player and the partial move.
+	 * 
+	 * The key is updated incrementally by every modification of the board. Border edges are 
+	 * hashed too, setEdgeCategory and loading can put them anywhere inside the board.
 	 */
-	QVector<Edge> edgesInside() const;
+	quint64 hash() const;
 
 	// Current player.
 
@@ -137,7 +165,10 @@ public:
 
 	// Current move.
 
-	const QVector<Direction>& currentMove() const;
+	/**
+	 * @returns a view of the current move, valid until the board is modified.
+	 */
+	Move currentMove() const;
 	void setCurrentMove(const QVector<Direction>& move);
 	void clearCurrentMove();
 
@@ -154,6 +185,12 @@ public:
 	bool canStepTo(QPoint point) const;
 	bool canPushSomeStep() const;
 
+	/**
+	 * A mask of directions in which a step can be pushed, bit i is set if 
+	 * canStepInDirection(directions[i]).
+	 */
+	quint8 stepDirections() const;
+
 	/**
 	 * Converts edges from the current move to old edges and clears the current move.
 	 * @returns the old move.
@@ -161,23 +198,40 @@ public:
 	QVector<Direction> convertCurrentMoveToOldEdges();
 	QVector<Direction> finishMove();
 
-private:
-	void undoConvertCurrentMoveToOldEdges(QVector<Direction>&& move);
-	void undoFinishMove(QVector<Direction>&& move);
-
-public:
+	/**
+	 * Finishes the move like finishMove, but doesn't return it, so it doesn't allocate memory.
+	 */
+	void endMove();
 
 	/**
 	 * Generates all possible boards after this move has been finished.
 	 * 
-	 * The callback gets the board after the move was finished and the move itself.
-	 * The callback can break enumeration early by returning false.
+	 * The visitor is called as visitor(Board&, Move) with the board after the move was finished 
+	 * and the move itself. The move is a view of the board's step stack, valid only during the call.
+	 * The visitor can break enumeration early by returning false.
 	 * The function modifies the board during enumeration, but undos all modifications before it exits.
+	 * It doesn't allocate any memory.
 	 * 
 	 * @returns Whether the enumeration completed without interruption.
 	 */
+	template <typename Visitor>
+	bool enumerateMoves(Visitor&& visitor);
+
+	/**
+	 * Same as above, but copies every move to a vector.
+	 */
 	bool enumerateMoves(std::function<bool (Board&, const QVector<Direction>&)> callback);
 
+	/**
+	 * Makes a move like enumerateMoves does: pushes @a steps (the steps after the current move) 
+	 * and finishes the move, if it can be finished and the game is not over. 
+	 * It doesn't allocate memory.
+	 * 
+	 * @returns a token for popMove, which undoes the move.
+	 */
+	int pushMove(Move steps);
+	void popMove(int token, int stepCount);
+
 	/**
 	 * Returns the winner, if there is one.
 	 * 
@@ -186,16 +240,145 @@ public:
 	 */
 	Maybe<Player> winner() const;
 
+	// Evaluation.
+
+	struct GoalDistances
+	{
+		/**
+		 * Distances to the goals, indexed by the player who wins in the goal.
+		 */
+		int goal[2];
+
+		/**
+		 * The number of points the ball can get to without finishing the move, 
+		 * including the ball's point.
+		 */
+		int reachable;
+	};
+
+	/**
+	 * Computes the distances from the ball to the goals over the empty edges, in moves: 
+	 * the number of moves that end on the way (steps to points without visited edges), 
+	 * so a goal reachable by bouncing in the current move has distance 0.
+	 * 
+	 * Only the player on move is assumed to move and the edges used on the way are not taken 
+	 * into account. The search is bounded, distances greater than @a limit (at most 254) 
+	 * are reported as limit + 1. It allocates memory only on boards of more than 128 points
+	 * (the 8x10 board has 117).
+	 */
+	GoalDistances goalDistances(int limit) const;
+
 private:
+	/**
+	 * The number of points in the largest board, including gates and the corners of the gate rows.
+	 */
+	static const int maxPoints = (maxSize + 1) * (maxSize + 3);
+
+	/**
+	 * Data that depends only on the board size, shared by all boards of that size.
+	 */
+	struct Layout;
+
+	/**
+	 * Random keys used to compute the hash.
+	 */
+	struct ZobristKeys;
+	static const ZobristKeys zobristKeys;
+
+	/**
+	 * Toggles the key of an edge in the given category.
+	 */
+	void hashEdge(int start, int end, Direction dir, EdgeCategory category);
+
+	/**
+	 * Returns the layout for the current size, building it on the first use.
+	 */
+	const Layout* findLayout() const;
+
+	/**
+	 * Sets the size (including gates) and clears all edges.
+	 */
+	void reset(QSize size);
+
+	/**
+	 * Points the masks to storage for the points of the layout.
+	 */
+	void allocateMasks();
+
+	/**
+	 * Checks the edge against the board shape, used to build the layout.
+	 */
+	bool computeEdgeInside(Edge edge) const;
+
+	/**
+	 * Boards with at most this many points (the 8x10 board has 117) keep the edge masks
+	 * in the object, larger boards allocate them.
+	 */
+	static const int smallPoints = 128;
+
+	/**
+	 * Finishes the current move like finishMove, but leaves its steps on the step stack.
+	 * @returns the position of the finished move on the stack.
+	 */
+	int pushFinishedMove();
+
+	/**
+	 * Reverts pushFinishedMove.
+	 */
+	void popFinishedMove(int moveStart);
+
+	/**
+	 * Marks the edges of the current move as new (or old).
+	 */
+	void markCurrentMoveNew(bool isNew);
+
+	/**
+	 * Maps a point in the bounding box of the board to an index in the masks.
+	 */
+	int pointIndex(QPoint point) const;
+
+	/**
+	 * The number of visited edges around a point, a single table lookup.
+	 */
+	int visitedCount(int index) const;
+
+	/**
+	 * A mask of directions in which the ball could move if the move was not finished.
+	 */
+	quint8 freeDirections() const;
+
+	/**
+	 * Sets or clears the bits of an edge in both of its end points.
+	 */
+	static void setEdgeBits(quint8* masks, int start, int end, Direction dir, bool on);
+
 	Shape<int, int, quint8>::IntervalsTuple intervals() const;
-	int edgeIndex(Edge edge) const;
 
 	QSize size_;
+	const Layout* layout_;
 	QPoint ball_;
-	Shape<int, int, quint8> shape;
-	QVector<EdgeCategory> edges;
+	int ballIndex_;
 	Player currentPlayer_;
-	QVector<Direction> currentMove_;
+	quint64 hash_;
+
+	// The step stack. It contains the current move, starting at moveStart_, preceded by
+	// moves finished during enumerateMoves. It's allocated by the first step, with room
+	// for all edges of the board (every step uses a different edge), so steps don't
+	// allocate after that.
+	int moveStart_;
+	int stepCount_;
+	std::unique_ptr<Direction[]> steps_;
+
+	// Per-point edge masks, layout_->pointCount each, stored one after another in smallMasks_
+	// or largeMasks_.
+	quint8* visited_;
+	quint8* border_;
+	quint8* new_;
+	quint8 smallMasks_[3 * smallPoints];
+	std::unique_ptr<quint8[]> largeMasks_;
+
+	// The number of points largeMasks_ has room for.
+	int largeCapacity_;
 
 	friend QDataStream& operator <<(QDataStream& stream, const Board& board);
 	friend QDataStream& operator >>(QDataStream& stream, Board& board);
@@ -204,6 +387,32 @@ private:
 QDataStream& operator <<(QDataStream& stream, const Board& board);
 QDataStream& operator >>(QDataStream& stream, Board& board);
 
+template <typename Visitor>
+bool Board::enumerateMoves(Visitor&& visitor)
+{
+	if (winner().isSome()) {
+		return visitor(*this, currentMove());
+	} else if (canFinishMove()) {
+		int moveStart = pushFinishedMove();
+		bool cont = visitor(*this, Move{steps_.get() + moveStart, stepCount_ - moveStart});
+		popFinishedMove(moveStart);
+		return cont;
+	} else {
+		quint8 free = freeDirections();
+		for (Direction dir : directions) {
+			if (free & (1 << dir)) {
+				pushStep(dir);
+				bool cont = enumerateMoves(visitor);
+				popStep();
+				if (!cont) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
 } // namespace ps
 
 #endif // PS_MODELS_BOARD_HPP
@@ -54,14 +54,42 @@ void GameConfig::setPlayerHuman(Player player, bool human)
 	isPlayerHuman_[static_cast<quint8>(player)] = human;
 }
 
+const AIConfig& GameConfig::aiConfig(Player player) const
+{
+	return aiConfig_[static_cast<quint8>(player)];
+}
+
+void GameConfig::setAIConfig(Player player, const AIConfig& config)
+{
+	aiConfig_[static_cast<quint8>(player)] = config;
+}
+
 QDataStream& operator<<(QDataStream& stream, const GameConfig& config)
 {
-	return stream << config.width_ << config.height_ << config.isPlayerHuman_[0] << config.isPlayerHuman_[1];
+	return stream << -GameConfig::formatVersion << config.width_ << config.height_ 
+		<< config.isPlayerHuman_[0] << config.isPlayerHuman_[1] << config.aiConfig_[0] << config.aiConfig_[1];
 }
 
 QDataStream& operator>>(QDataStream& stream, GameConfig& config)
 {
-	return stream >> config.width_ >> config.height_ >> config.isPlayerHuman_[0] >> config.isPlayerHuman_[1];
+	qint32 first;
+	stream >> first;
+
+	// Files without a version have no AI settings.
+	if (first >= 0) {
+		config.width_ = first;
+		config.aiConfig_[0] = AIConfig{};
+		config.aiConfig_[1] = AIConfig{};
+		return stream >> config.height_ >> config.isPlayerHuman_[0] >> config.isPlayerHuman_[1];
+	}
+
+	if (-first > GameConfig::formatVersion) {
+		stream.setStatus(QDataStream::ReadCorruptData);
+		return stream;
+	}
+
+	return stream >> config.width_ >> config.height_ >> config.isPlayerHuman_[0] >> config.isPlayerHuman_[1]
+		>> config.aiConfig_[0] >> config.aiConfig_[1];
 }
 
 } // namespace ps
@@ -2,6 +2,7 @@
 #define PS_MODELS_GAMECONFIG_HPP
 
 #include "board.hpp"
+#include "aiconfig.hpp"
 
 #include <QtCore/QDataStream>
 
@@ -12,7 +13,7 @@ class GameConfig
 {
 public:
 	static const int minSize = 2;
-	static const int maxSize = 30;
+	static const int maxSize = Board::maxSize;
 
 	GameConfig();
 	GameConfig(const GameConfig&) = default;
@@ -32,13 +33,26 @@ public:
 	bool isPlayerHuman(Player player) const;
 	void setPlayerHuman(Player player, bool human);
 
+	/**
+	 * Settings of the player's AI (or hints, if the player is human).
+	 */
+	const AIConfig& aiConfig(Player player) const;
+	void setAIConfig(Player player, const AIConfig& config);
+
 private:
 	friend QDataStream& operator <<(QDataStream& stream, const GameConfig& config);
 	friend QDataStream& operator >>(QDataStream& stream, GameConfig& config);
 
+	/**
+	 * Saved before the other fields as a negative number, files from before versioning start
+	 * with the (positive) width.
+	 */
+	static const qint32 formatVersion = 1;
+
 	int width_;
 	int height_;
 	bool isPlayerHuman_[2];
+	AIConfig aiConfig_[2];
 };
 
 QDataStream& operator <<(QDataStream& stream, const GameConfig& config);
@@ -0,0 +1,71 @@
+#include "move.hpp"
+
+#include <algorithm>
+
+namespace ps {
+
+Move::Move()
+	: steps_(nullptr)
+	, size_(0)
+{
+}
+
+Move::Move(const Direction* steps, int size)
+	: steps_(steps)
+	, size_(size)
+{
+}
+
+int Move::size() const
+{
+	return size_;
+}
+
+bool Move::empty() const
+{
+	return size_ == 0;
+}
+
+Direction Move::operator[](int i) const
+{
+	Q_ASSERT(i >= 0 && i < size_);
+	return steps_[i];
+}
+
+Direction Move::back() const
+{
+	Q_ASSERT(!empty());
+	return steps_[size_ - 1];
+}
+
+const Direction* Move::begin() const
+{
+	return steps_;
+}
+
+const Direction* Move::end() const
+{
+	return steps_ + size_;
+}
+
+QVector<Direction> Move::toVector() const
+{
+	QVector<Direction> steps;
+	steps.reserve(size_);
+	for (Direction dir : *this) {
+		steps.push_back(dir);
+	}
+	return steps;
+}
+
+bool Move::operator==(const Move& move) const
+{
+	return size_ == move.size_ && std::equal(begin(), end(), move.begin());
+}
+
+bool Move::operator!=(const Move& move) const
+{
+	return !(*this == move);
+}
+
+} // namespace ps
@@ -0,0 +1,61 @@
+#ifndef PS_MODELS_MOVE_HPP
+#define PS_MODELS_MOVE_HPP
+
+#include "direction.hpp"
+
+#include <QtCore/QVector>
+
+namespace ps {
+
+/**
+ * A read-only view of the steps of a (possibly partial) move.
+ * 
+ * Move does not own the steps. It is valid only as long as the buffer it points into 
+ * (usually the step stack of a board) is not modified.
+ */
+class Move
+{
+public:
+	/**
+	 * Creates an empty move.
+	 */
+	Move();
+
+	/**
+	 * Creates a view of @a size steps starting at @a steps.
+	 */
+	Move(const Direction* steps, int size);
+
+	Move(const Move&) = default;
+	Move& operator =(const Move&) = default;
+
+	int size() const;
+	bool empty() const;
+
+	Direction operator [](int i) const;
+	Direction back() const;
+
+	const Direction* begin() const;
+	const Direction* end() const;
+
+	/**
+	 * Copies the steps to a vector.
+	 */
+	QVector<Direction> toVector() const;
+
+	/**
+	 * Compares the steps of two moves.
+	 */
+	//@{
+	bool operator ==(const Move& move) const;
+	bool operator !=(const Move& move) const;
+	//@}
+
+private:
+	const Direction* steps_;
+	int size_;
+};
+
+} // namespace ps
+
+#endif // PS_MODELS_MOVE_HPP
@@ -0,0 +1,244 @@
+#include "solver.hpp"
+
+#include <utility>
+
+namespace ps {
+
+/**
+ * Proof and disproof numbers of solved positions, sums are capped at this.
+ */
+const quint32 infinity = 1u << 30;
+
+/**
+ * A fixed-size hash table of proof and disproof numbers. A key is mapped to a bucket by its
+ * low bits, a new position replaces the entry of the bucket with the least work.
+ */
+struct Solver::Table
+{
+	struct Entry
+	{
+		quint64 key;
+		quint32 proof;
+		quint32 disproof;
+
+		/**
+		 * The number of positions searched to get the numbers.
+		 */
+		quint64 work;
+	};
+
+	static const int bucketSize = 4;
+
+	explicit Table(size_t bytes);
+
+	/**
+	 * Sets the numbers of a position, if it is in the table.
+	 */
+	bool probe(quint64 key, quint32& proof, quint32& disproof) const;
+	void store(quint64 key, quint32 proof, quint32 disproof, quint64 work);
+
+	std::unique_ptr<Entry[]> entries;
+	quint64 mask;
+};
+
+Solver::Table::Table(size_t bytes)
+{
+	size_t count = 1;
+	while (count * 2 * bucketSize * sizeof(Entry) <= bytes) {
+		count *= 2;
+	}
+
+	// Key 0 is used as "empty", a real position hashing to 0 will just never be found.
+	entries.reset(new Entry[count * bucketSize]);
+	mask = count - 1;
+	for (size_t i = 0; i < count * bucketSize; i++) {
+		entries[i] = Entry{0, 0, 0, 0};
+	}
+}
+
+bool Solver::Table::probe(quint64 key, quint32& proof, quint32& disproof) const
+{
+	const Entry* bucket = &entries[(key & mask) * bucketSize];
+	for (int i = 0; i < bucketSize; i++) {
+		if (bucket[i].key == key && key != 0) {
+			proof = bucket[i].proof;
+			disproof = bucket[i].disproof;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Solver::Table::store(quint64 key, quint32 proof, quint32 disproof, quint64 work)
+{
+	Entry* bucket = &entries[(key & mask) * bucketSize];
+	Entry* replaced = bucket;
+	for (int i = 0; i < bucketSize; i++) {
+		if (bucket[i].key == key) {
+			replaced = &bucket[i];
+			work += bucket[i].work;
+			break;
+		}
+		if (bucket[i].work < replaced->work) {
+			replaced = &bucket[i];
+		}
+	}
+	*replaced = Entry{key, proof, disproof, work};
+}
+
+Solver::Solver(size_t memoryLimit)
+	: table(new Table(memoryLimit))
+	, nodeLimit(0)
+	, nodes(0)
+	, stopped(false)
+{
+}
+
+Solver::~Solver()
+{
+}
+
+void Solver::setNodeLimit(quint64 limit)
+{
+	nodeLimit = limit;
+}
+
+Solver::Result Solver::solve(const Board& board, const CancellationToken& token)
+{
+	this->token = token;
+	nodes = 0;
+	stopped = false;
+
+	Result result;
+	Maybe<Player> winner = board.winner();
+	if (winner.isSome()) {
+		result.outcome = winner.get() == board.currentPlayer() ? Outcome::Win : Outcome::Loss;
+		result.nodeCount = 0;
+		return result;
+	}
+
+	Board line = board;
+	quint32 proof;
+	quint32 disproof;
+	Child best = search(line, infinity, infinity, proof, disproof);
+
+	// Follow the proof through the rest of the move, the positions on the way are already 
+	// proven, so they are searched again only if they were replaced in the table.
+	while (proof == 0 && best.step >= 0) {
+		line.pushStep(static_cast<Direction>(best.step));
+		if (line.winner().isSome() || line.canFinishMove()) {
+			break;
+		}
+		best = search(line, infinity, infinity, proof, disproof);
+	}
+
+	if (proof == 0) {
+		result.outcome = Outcome::Win;
+		result.move = line.currentMove().toVector();
+	} else if (disproof == 0) {
+		result.outcome = Outcome::Loss;
+	} else {
+		result.outcome = Outcome::Unknown;
+	}
+	result.nodeCount = nodes;
+	return result;
+}
+
+Solver::Child Solver::search(Board& board, quint32 proofLimit, quint32 disproofLimit,
+	quint32& proof, quint32& disproof)
+{
+	quint64 nodesBefore = nodes++;
+	if ((nodeLimit != 0 && nodes >= nodeLimit) || ((nodes & 1023) == 0 && token.isCancelled())) {
+		stopped = true;
+	}
+
+	// A complete move can only be finished, otherwise the ball goes on in any free direction.
+	// The children start with the numbers from the table, if there are any.
+	int childrenStart = children.size();
+	Player mover = board.currentPlayer();
+	quint8 free = board.canFinishMove() ? 0 : board.stepDirections();
+	for (int i = free == 0 ? -1 : 0; i < 8; i++) {
+		if (i >= 0 && !(free & (1 << directions[i]))) {
+			continue;
+		}
+
+		Child child;
+		child.step = i < 0 ? -1 : directions[i];
+		int token = doStep(board, child);
+		Maybe<Player> winner = board.winner();
+		quint32 proof = 1;
+		quint32 disproof = 1;
+		if (winner.isSome()) {
+			proof = winner.get() == mover ? 0 : infinity;
+			disproof = winner.get() == mover ? infinity : 0;
+		} else if (table->probe(board.hash(), proof, disproof) && board.currentPlayer() != mover) {
+			std::swap(proof, disproof);
+		}
+		child.proof = proof;
+		child.disproof = disproof;
+		undoStep(board, child, token);
+		children.append(child);
+
+		if (i < 0) {
+			break;
+		}
+	}
+
+	int best = -1;
+	while (true) {
+		// The player on move needs one step that wins, but to lose all of them have to lose.
+		quint32 second = infinity;
+		proof = infinity;
+		disproof = 0;
+		for (int i = childrenStart; i < children.size(); i++) {
+			const Child& child = children[i];
+			if (i == childrenStart || child.proof < proof) {
+				second = proof;
+				proof = child.proof;
+				best = i;
+			} else if (child.proof < second) {
+				second = child.proof;
+			}
+			disproof = qMin<quint64>(quint64(disproof) + child.disproof, infinity);
+		}
+
+		if (proof >= proofLimit || disproof >= disproofLimit || stopped) {
+			break;
+		}
+
+		// Search the most proving child until it stops being the best one
+		// or the disproof number of this position reaches its limit.
+		Child child = children[best];
+		quint32 childProofLimit = qMin(proofLimit, second + 1);
+		quint32 childDisproofLimit = qMin<quint64>(quint64(disproofLimit) - disproof + child.disproof, infinity);
+		int token = doStep(board, child);
+		if (board.currentPlayer() == mover) {
+			search(board, childProofLimit, childDisproofLimit, child.proof, child.disproof);
+		} else {
+			search(board, childDisproofLimit, childProofLimit, child.disproof, child.proof);
+		}
+		undoStep(board, child, token);
+		children[best] = child;
+	}
+
+	Child result = children[best];
+	table->store(board.hash(), proof, disproof, nodes - nodesBefore);
+	children.resize(childrenStart);
+	return result;
+}
+
+int Solver::doStep(Board& board, const Child& child)
+{
+	if (child.step < 0) {
+		return board.pushMove(Move(nullptr, 0));
+	}
+	Direction dir = static_cast<Direction>(child.step);
+	return board.pushMove(Move(&dir, 1));
+}
+
+void Solver::undoStep(Board& board, const Child& child, int token)
+{
+	board.popMove(token, child.step < 0 ? 0 : 1);
+}
+
+} // namespace ps
@@ -0,0 +1,133 @@
+#ifndef PS_SOLVER_HPP
+#define PS_SOLVER_HPP
+
+#include "models/board.hpp"
+#include "cancellationtoken.hpp"
+
+#include <memory>
+
+namespace ps
+{
+
+/**
+ * Proves or disproves a forced win of the player on move, by depth-first proof-number
+ * search (df-pn).
+ *
+ * Every position has a proof number (how many positions at least have to be solved to prove
+ * the win of the player on move) and a disproof number (the same for a loss). The search
+ * always expands the most proving position, descending only while the numbers stay below
+ * the thresholds given by the parent, so unlike alpha-beta it follows narrow forcing lines
+ * to any depth.
+ *
+ * The positions are searched by steps rather than by complete moves: a move with many 
+ * bounces can be made in too many ways to enumerate, while its partial moves have at most
+ * eight continuations and a lot of them transpose.
+ *
+ * The numbers are kept in a table of a fixed size, positions which took the least work
+ * to solve are replaced first. The search stops when the result is known, when it is
+ * cancelled or when the node limit is reached.
+ */
+class Solver
+{
+public:
+	enum class Outcome : quint8
+	{
+		/**
+		 * The player on move can force a win.
+		 */
+		Win = 0,
+
+		/**
+		 * The opponent can force a win, whatever the player on move does.
+		 */
+		Loss = 1,
+
+		/**
+		 * The search was stopped before the result was known.
+		 */
+		Unknown = 2
+	};
+
+	struct Result
+	{
+		Outcome outcome;
+
+		/**
+		 * The current move of a winning move (including the steps made before the search),
+		 * empty unless the outcome is Win and the game isn't over already.
+		 */
+		QVector<Direction> move;
+
+		/**
+		 * The number of positions searched.
+		 */
+		quint64 nodeCount;
+	};
+
+	/**
+	 * Creates a solver whose table uses at most @a memoryLimit bytes (but at least one bucket).
+	 */
+	explicit Solver(size_t memoryLimit);
+	~Solver();
+
+	/**
+	 * Stops the search after @a limit positions, 0 means no limit.
+	 */
+	void setNodeLimit(quint64 limit);
+
+	/**
+	 * Solves @a board for the player on move, in the calling thread. The table is kept,
+	 * so solving a later position of the same game reuses the results.
+	 */
+	Result solve(const Board& board, const CancellationToken& token = CancellationToken());
+
+private:
+	struct Table;
+
+	/**
+	 * A step from a searched position and its numbers from the point of view of the player
+	 * on move in that position.
+	 */
+	struct Child
+	{
+		quint32 proof;
+		quint32 disproof;
+
+		/**
+		 * The direction of the step, or -1 if the child finishes the current move.
+		 */
+		qint8 step;
+	};
+
+	/**
+	 * Searches @a board until its proof number reaches @a proofLimit or its disproof number
+	 * reaches @a disproofLimit, sets the numbers and stores them in the table.
+	 * @returns the child with the smallest proof number.
+	 */
+	Child search(Board& board, quint32 proofLimit, quint32 disproofLimit,
+		quint32& proof, quint32& disproof);
+
+	/**
+	 * Makes the step of a child, the move is finished if it can be.
+	 * @returns a token for undoStep.
+	 */
+	static int doStep(Board& board, const Child& child);
+	static void undoStep(Board& board, const Child& child, int token);
+
+	std::unique_ptr<Table> table;
+	quint64 nodeLimit;
+
+	// The current search.
+	CancellationToken token;
+	quint64 nodes;
+	bool stopped;
+
+	/**
+	 * A stack of the children of all positions on the current line.
+	 */
+	QVector<Child> children;
+};
+
+} // namespace ps
+
+#endif // PS_SOLVER_HPP
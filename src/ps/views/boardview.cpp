@@ -254,7 +254,7 @@ void BoardView::paintEvent(QPaintEvent* event)
 	}
 
 	// Draw edges.
-	for (Edge e : board()->edgesInside()) {
+	for (const Edge& e : board()->edgesInside()) {
 		switch (board()->edgeCategory(e)) {
 			case EdgeCategory::Empty:
 				continue;
@@ -5,6 +5,37 @@
 
 namespace ps {
 
+namespace {
+
+template <typename T>
+struct Identity
+{
+	typedef T Type;
+};
+
+/**
+ * Connects @a signal of the boxes of both players to @a set, which changes the AI config of
+ * the player. The signal's type is given by Value and Box, so that overloaded signals and 
+ * signals of base classes need no cast.
+ */
+template <typename Value, typename Box, typename Set>
+void connectAIBoxes(GameConfigView* view, Box* playerOneBox, Box* playerTwoBox, 
+	typename Identity<void (Box::*)(Value)>::Type signal, Set set)
+{
+	for (Player player : {Player::One, Player::Two}) {
+		Box* box = player == Player::One ? playerOneBox : playerTwoBox;
+		QObject::connect(box, signal, [view, box, player, set] (Value value) {
+			if (view->config()) {
+				AIConfig aiConfig = view->config()->aiConfig(player);
+				set(aiConfig, box, value);
+				view->config()->setAIConfig(player, aiConfig);
+			}
+		});
+	}
+}
+
+} // namespace
+
 GameConfigView::GameConfigView(QWidget* parent, Qt::WindowFlags f)
 	: QWidget(parent, f)
 	, ui(new Ui_GameConfig)
@@ -14,6 +45,38 @@ GameConfigView::GameConfigView(QWidget* parent, Qt::WindowFlags f)
 	ui->widthBox->setMaximum(GameConfig::maxSize);
 	ui->heightBox->setMinimum(GameConfig::minSize);
 	ui->heightBox->setMaximum(GameConfig::maxSize);
+	for (QComboBox* box : {ui->playerOneEngineBox, ui->playerTwoEngineBox}) {
+		box->addItem(tr("Alpha-beta"), static_cast<int>(AIConfig::Engine::AlphaBeta));
+		box->addItem(tr("Alpha-beta, Lazy SMP"), static_cast<int>(AIConfig::Engine::LazySmp));
+		box->addItem(tr("Monte Carlo"), static_cast<int>(AIConfig::Engine::MonteCarlo));
+	}
+	for (QComboBox* box : {ui->playerOneEvaluationBox, ui->playerTwoEvaluationBox}) {
+		box->addItem(tr("Ball row"), static_cast<int>(AIConfig::Evaluation::BallRow));
+		box->addItem(tr("Goal distance"), static_cast<int>(AIConfig::Evaluation::GoalDistance));
+	}
+	for (QDoubleSpinBox* box : {ui->playerOneTimeBox, ui->playerTwoTimeBox}) {
+		box->setMinimum(AIConfig::minTimeLimit / 1000.0);
+		box->setMaximum(AIConfig::maxTimeLimit / 1000.0);
+		box->setSingleStep(0.5);
+	}
+	for (QSpinBox* box : {ui->playerOneDepthBox, ui->playerTwoDepthBox}) {
+		box->setMinimum(1);
+		box->setMaximum(AIConfig::maxDepth);
+	}
+	for (QSpinBox* box : {ui->playerOneTableBox, ui->playerTwoTableBox}) {
+		box->setMinimum(1);
+		box->setMaximum(AIConfig::maxTableSize);
+		box->setSingleStep(16);
+	}
+	for (QSpinBox* box : {ui->playerOneThreadsBox, ui->playerTwoThreadsBox}) {
+		box->setMinimum(1);
+		box->setMaximum(AIConfig::maxThreadCount);
+	}
+	for (QSpinBox* box : {ui->playerOnePlayoutsBox, ui->playerTwoPlayoutsBox}) {
+		box->setMinimum(0);
+		box->setMaximum(AIConfig::maxPlayoutLimit);
+		box->setSingleStep(1000);
+	}
 
 	connect(ui->widthBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), [this] (int value) {
 		if (config()) {
@@ -47,6 +110,59 @@ GameConfigView::GameConfigView(QWidget* parent, Qt::WindowFlags f)
 		}
 	});
 
+	connectAIBoxes<int>(this, ui->playerOneEngineBox, ui->playerTwoEngineBox, &QComboBox::currentIndexChanged,
+		[] (AIConfig& aiConfig, QComboBox* box, int index) {
+			if (index >= 0) {
+				aiConfig.setEngine(static_cast<AIConfig::Engine>(box->itemData(index).toInt()));
+			}
+		});
+	connectAIBoxes<int>(this, ui->playerOneEvaluationBox, ui->playerTwoEvaluationBox, &QComboBox::currentIndexChanged,
+		[] (AIConfig& aiConfig, QComboBox* box, int index) {
+			if (index >= 0) {
+				aiConfig.setEvaluation(static_cast<AIConfig::Evaluation>(box->itemData(index).toInt()));
+			}
+		});
+	connectAIBoxes<double>(this, ui->playerOneTimeBox, ui->playerTwoTimeBox, &QDoubleSpinBox::valueChanged,
+		[] (AIConfig& aiConfig, QDoubleSpinBox*, double value) {
+			aiConfig.setTimeLimit(qRound(value * 1000));
+		});
+	connectAIBoxes<int>(this, ui->playerOneDepthBox, ui->playerTwoDepthBox, &QSpinBox::valueChanged,
+		[] (AIConfig& aiConfig, QSpinBox*, int value) {
+			aiConfig.setDepthLimit(value);
+		});
+	connectAIBoxes<int>(this, ui->playerOneTableBox, ui->playerTwoTableBox, &QSpinBox::valueChanged,
+		[] (AIConfig& aiConfig, QSpinBox*, int value) {
+			aiConfig.setTableSize(value);
+		});
+	connectAIBoxes<int>(this, ui->playerOneThreadsBox, ui->playerTwoThreadsBox, &QSpinBox::valueChanged,
+		[] (AIConfig& aiConfig, QSpinBox*, int value) {
+			aiConfig.setThreadCount(value);
+		});
+	connectAIBoxes<int>(this, ui->playerOnePlayoutsBox, ui->playerTwoPlayoutsBox, &QSpinBox::valueChanged,
+		[] (AIConfig& aiConfig, QSpinBox*, int value) {
+			aiConfig.setPlayoutLimit(value);
+		});
+	connectAIBoxes<bool>(this, ui->playerOnePonderBox, ui->playerTwoPonderBox, &QCheckBox::toggled,
+		[] (AIConfig& aiConfig, QCheckBox*, bool checked) {
+			aiConfig.setPonder(checked);
+		});
+	connectAIBoxes<bool>(this, ui->playerOnePvsBox, ui->playerTwoPvsBox, &QCheckBox::toggled,
+		[] (AIConfig& aiConfig, QCheckBox*, bool checked) {
+			aiConfig.setPrincipalVariationSearch(checked);
+		});
+	connectAIBoxes<bool>(this, ui->playerOneAspirationBox, ui->playerTwoAspirationBox, &QCheckBox::toggled,
+		[] (AIConfig& aiConfig, QCheckBox*, bool checked) {
+			aiConfig.setAspirationWindows(checked);
+		});
+	connectAIBoxes<bool>(this, ui->playerOneBookBox, ui->playerTwoBookBox, &QCheckBox::toggled,
+		[] (AIConfig& aiConfig, QCheckBox*, bool checked) {
+			aiConfig.setUseBook(checked);
+		});
+	connectAIBoxes<const QString&>(this, ui->playerOneBookEdit, ui->playerTwoBookEdit, &QLineEdit::textChanged,
+		[] (AIConfig& aiConfig, QLineEdit*, const QString& text) {
+			aiConfig.setBookPath(text);
+		});
+
 	connect(ui->cancelButton, &QPushButton::clicked, this, &GameConfigView::cancelClicked);
 	connect(ui->startGameButton, &QPushButton::clicked, this, &GameConfigView::startGameClicked);
 }
@@ -66,6 +182,34 @@ void GameConfigView::setConfig(GameConfig* config)
 		ui->playerOneAI->setChecked(!config->isPlayerHuman(Player::One));
 		ui->playerTwoHuman->setChecked(config->isPlayerHuman(Player::Two));
 		ui->playerTwoAI->setChecked(!config->isPlayerHuman(Player::Two));
+		ui->playerOneEngineBox->setCurrentIndex(
+			ui->playerOneEngineBox->findData(static_cast<int>(config->aiConfig(Player::One).engine())));
+		ui->playerTwoEngineBox->setCurrentIndex(
+			ui->playerTwoEngineBox->findData(static_cast<int>(config->aiConfig(Player::Two).engine())));
+		ui->playerOneEvaluationBox->setCurrentIndex(
+			ui->playerOneEvaluationBox->findData(static_cast<int>(config->aiConfig(Player::One).evaluation())));
+		ui->playerTwoEvaluationBox->setCurrentIndex(
+			ui->playerTwoEvaluationBox->findData(static_cast<int>(config->aiConfig(Player::Two).evaluation())));
+		ui->playerOneTimeBox->setValue(config->aiConfig(Player::One).timeLimit() / 1000.0);
+		ui->playerTwoTimeBox->setValue(config->aiConfig(Player::Two).timeLimit() / 1000.0);
+		ui->playerOneDepthBox->setValue(config->aiConfig(Player::One).depthLimit());
+		ui->playerTwoDepthBox->setValue(config->aiConfig(Player::Two).depthLimit());
+		ui->playerOneTableBox->setValue(config->aiConfig(Player::One).tableSize());
+		ui->playerTwoTableBox->setValue(config->aiConfig(Player::Two).tableSize());
+		ui->playerOneThreadsBox->setValue(config->aiConfig(Player::One).threadCount());
+		ui->playerTwoThreadsBox->setValue(config->aiConfig(Player::Two).threadCount());
+		ui->playerOnePlayoutsBox->setValue(config->aiConfig(Player::One).playoutLimit());
+		ui->playerTwoPlayoutsBox->setValue(config->aiConfig(Player::Two).playoutLimit());
+		ui->playerOnePonderBox->setChecked(config->aiConfig(Player::One).ponder());
+		ui->playerTwoPonderBox->setChecked(config->aiConfig(Player::Two).ponder());
+		ui->playerOnePvsBox->setChecked(config->aiConfig(Player::One).principalVariationSearch());
+		ui->playerTwoPvsBox->setChecked(config->aiConfig(Player::Two).principalVariationSearch());
+		ui->playerOneAspirationBox->setChecked(config->aiConfig(Player::One).aspirationWindows());
+		ui->playerTwoAspirationBox->setChecked(config->aiConfig(Player::Two).aspirationWindows());
+		ui->playerOneBookBox->setChecked(config->aiConfig(Player::One).useBook());
+		ui->playerTwoBookBox->setChecked(config->aiConfig(Player::Two).useBook());
+		ui->playerOneBookEdit->setText(config->aiConfig(Player::One).bookPath());
+		ui->playerTwoBookEdit->setText(config->aiConfig(Player::Two).bookPath());
 	}
 }
 
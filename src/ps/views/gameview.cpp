@@ -49,6 +49,11 @@ QPushButton* GameView::stopHintButton()
 	return ui->stopHintButton;
 }
 
+QPushButton* GameView::solveButton()
+{
+	return ui->solveButton;
+}
+
 QWidget* GameView::aiBox()
 {
 	return ui->aiBox;
@@ -31,6 +31,7 @@ public:
 	QWidget* hintBox();
 	QPushButton* startHintButton();
 	QPushButton* stopHintButton();
+	QPushButton* solveButton();
 	QWidget* aiBox();
 	QPushButton* startAiButton();
 	QPushButton* stopAiButton();
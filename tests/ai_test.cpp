@@ -0,0 +1,98 @@
+#include "ps/ai.hpp"
+
+#include <QtCore/QTextStream>
+
+#include <algorithm>
+#include <random>
+
+using namespace ps;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what, QSize size, quint32 seed, int depth, int hashMove)
+{
+	if (!condition) {
+		failures++;
+		QTextStream err(stderr);
+		err << size.width() << "x" << size.height() << ", seed " << seed << ", depth " << depth
+			<< ", hash move " << hashMove << ": " << what << "\n";
+		err.flush();
+	}
+}
+
+/**
+ * Exposes the move order of alphabeta.
+ */
+class TestAI : public AI
+{
+public:
+	using AI::searchOrder;
+};
+
+/**
+ * Checks that the hash move changes only the order of the moves searched in the positions
+ * of a random game, not the moves themselves.
+ */
+void checkGame(QSize size, quint32 seed)
+{
+	std::mt19937 random(seed);
+	TestAI ai;
+	Board board(size);
+	for (int step = 0; step < 60 && board.winner().isNone(); step++) {
+		int moveCount = 0;
+		board.enumerateMoves([&] (Board&, Move) {
+			return ++moveCount < 200;
+		});
+
+		for (int depth = 1; depth <= 4; depth++) {
+			QVector<int> searched = ai.searchOrder(board, depth, -1);
+			std::sort(searched.begin(), searched.end());
+			bool prefix = !searched.isEmpty();
+			for (int i = 0; i < searched.size(); i++) {
+				prefix = prefix && searched[i] == i;
+			}
+			check(prefix, "not a prefix of the enumeration order", size, seed, depth, -1);
+
+			for (int hashMove = 0; hashMove <= moveCount; hashMove++) {
+				QVector<int> order = ai.searchOrder(board, depth, hashMove);
+				bool first = !order.isEmpty() && order.first() == hashMove;
+				check(first == (hashMove < searched.size()), "the hash move is not first", size, seed, depth, hashMove);
+				std::sort(order.begin(), order.end());
+				check(order == searched, "different moves with a hash move", size, seed, depth, hashMove);
+			}
+		}
+
+		if (board.canFinishMove() && random() % 2 == 0) {
+			board.finishMove();
+			continue;
+		}
+		QVector<Direction> free;
+		for (Direction dir : directions) {
+			if (board.canStepInDirection(dir)) {
+				free.append(dir);
+			}
+		}
+		if (free.isEmpty()) {
+			break;
+		}
+		board.pushStep(free[random() % free.size()]);
+	}
+}
+
+} // namespace
+
+/**
+ * Checks the moves searched by the AI.
+ */
+int main()
+{
+	// Moves get long on crowded boards, so that they use up the depth.
+	for (QSize size : {QSize(8, 10), QSize(4, 6), QSize(12, 12)}) {
+		for (quint32 seed = 1; seed <= 5; seed++) {
+			checkGame(size, seed);
+		}
+	}
+	return failures == 0 ? 0 : 1;
+}
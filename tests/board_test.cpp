@@ -0,0 +1,196 @@
+#include "ps/models/board.hpp"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QTextStream>
+
+#include <random>
+
+using namespace ps;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what, QSize size, quint32 seed, int step)
+{
+	if (!condition) {
+		failures++;
+		QTextStream err(stderr);
+		err << size.width() << "x" << size.height() << ", seed " << seed << ", step " << step << ": " << what << "\n";
+		err.flush();
+	}
+}
+
+/**
+ * Compares everything observable about two boards, including the edges and the legal steps.
+ */
+bool same(const Board& a, const Board& b)
+{
+	if (a.size() != b.size() || a.hash() != b.hash() || a.ball() != b.ball()
+		|| a.currentPlayer() != b.currentPlayer() || a.currentMove().toVector() != b.currentMove().toVector()
+		|| a.canFinishMove() != b.canFinishMove() || a.winner() != b.winner()) {
+		return false;
+	}
+	for (Direction dir : directions) {
+		if (a.canStepInDirection(dir) != b.canStepInDirection(dir)) {
+			return false;
+		}
+	}
+	for (const Edge& edge : a.edgesInside()) {
+		if (a.edgeCategory(edge) != b.edgeCategory(edge)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Saves and loads @a board. The loaded board computes its hash from scratch.
+ */
+Board roundTrip(const Board& board, Board loaded = Board())
+{
+	QByteArray data;
+	QDataStream out(&data, QIODevice::WriteOnly);
+	out << board;
+	QDataStream in(data);
+	in >> loaded;
+	return loaded;
+}
+
+/**
+ * Checks the boards of a random game: copies, moves and saved boards are the same as the
+ * original, and the incrementally updated hash is the hash computed from scratch.
+ */
+void checkGame(QSize size, quint32 seed)
+{
+	std::mt19937 random(seed);
+	Board board(size);
+	// A board of another size, so that assigning to it changes the layout.
+	Board other(QSize(size.width() == 8 ? 6 : 8, 10));
+	for (int step = 0; board.winner().isNone(); step++) {
+		Board copy(board);
+		check(same(copy, board), "copy constructed", size, seed, step);
+		other = board;
+		check(same(other, board), "copy assigned", size, seed, step);
+		Board moved(std::move(copy));
+		check(same(moved, board), "move constructed", size, seed, step);
+		other = std::move(moved);
+		check(same(other, board), "move assigned", size, seed, step);
+		check(same(roundTrip(board), board), "saved and loaded", size, seed, step);
+
+		// Every step is undone exactly.
+		QVector<Direction> free;
+		for (Direction dir : directions) {
+			if (board.canStepInDirection(dir)) {
+				quint64 hash = board.hash();
+				board.pushStep(dir);
+				check(same(roundTrip(board), board), "saved and loaded after a step", size, seed, step);
+				board.popStep();
+				check(board.hash() == hash, "hash restored by popStep", size, seed, step);
+				free.append(dir);
+			}
+		}
+
+		// Moves enumerated from the start of a turn are the moves made step by step.
+		if (board.currentMove().empty()) {
+			Board start(board);
+			int count = 0;
+			board.enumerateMoves([&] (Board& child, Move move) {
+				Board played(start);
+				for (Direction dir : move) {
+					played.pushStep(dir);
+				}
+				if (played.winner().isNone()) {
+					played.finishMove();
+				}
+				check(same(played, child), "enumerated move", size, seed, step);
+				check(same(Board(child), child), "copy of an enumerated move", size, seed, step);
+				return ++count < 100;
+			});
+			check(same(board, start), "board restored by enumerateMoves", size, seed, step);
+		}
+
+		if (board.canFinishMove() && random() % 2 == 0) {
+			board.finishMove();
+		} else if (free.isEmpty()) {
+			break;
+		} else {
+			board.pushStep(free[random() % free.size()]);
+		}
+	}
+}
+
+/**
+ * Checks that a board reused for boards of other sizes, growing and shrinking, is the same
+ * as the assigned, moved or loaded one.
+ */
+void checkSizeChanges()
+{
+	// 12x12 and larger boards keep their masks on the heap.
+	const QSize sizes[] = {QSize(20, 20), QSize(30, 30), QSize(12, 12), QSize(30, 30), QSize(8, 10), QSize(24, 28)};
+	Board assigned(sizes[0]);
+	Board moved(sizes[0]);
+	Board loaded(sizes[0]);
+	for (int i = 0; i < 6; i++) {
+		QSize size = sizes[i];
+		std::mt19937 random(i);
+		Board board(size);
+		for (int step = 0; step < 20 && board.winner().isNone() && board.canPushSomeStep(); step++) {
+			Direction dir;
+			do {
+				dir = directions[random() % 8];
+			} while (!board.canStepInDirection(dir));
+			board.pushStep(dir);
+		}
+
+		assigned = board;
+		check(same(assigned, board), "copy assigned over another size", size, 0, i);
+		Board copy(board);
+		moved = std::move(copy);
+		check(same(moved, board), "move assigned over another size", size, 0, i);
+		loaded = roundTrip(board, std::move(loaded));
+		check(same(loaded, board), "loaded over another size", size, 0, i);
+	}
+}
+
+/**
+ * Checks that a border edge put inside the board changes the hash, and is kept by saving.
+ */
+void checkBorderEdges()
+{
+	QSize size(8, 10);
+	for (const Edge& edge : Board(size).edgesInside()) {
+		Board board(size);
+		if (board.edgeCategory(edge) != EdgeCategory::Empty) {
+			continue;
+		}
+		quint64 hash = board.hash();
+		board.setEdgeCategory(edge, EdgeCategory::Border);
+		check(board.hash() != hash, "border edge not hashed", size, 0, 0);
+		check(same(roundTrip(board), board), "saved and loaded with a border edge", size, 0, 0);
+
+		Board old(size);
+		old.setEdgeCategory(edge, EdgeCategory::Old);
+		check(board.hash() != old.hash(), "border edge hashed as an old one", size, 0, 0);
+		board.setEdgeCategory(edge, EdgeCategory::Empty);
+		check(board.hash() == hash, "hash restored without the border edge", size, 0, 0);
+	}
+}
+
+} // namespace
+
+/**
+ * Checks that copying, moving and saving boards keeps the position and its hash.
+ */
+int main()
+{
+	// 30x30 keeps its edge masks on the heap, the other sizes in the board.
+	for (QSize size : {QSize(8, 10), QSize(2, 4), QSize(6, 6), QSize(12, 12), QSize(30, 30)}) {
+		for (quint32 seed = 1; seed <= 20; seed++) {
+			checkGame(size, seed);
+		}
+	}
+	checkSizeChanges();
+	checkBorderEdges();
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#include "ps/engine/montecarlotree.hpp"
+
+#include <QtCore/QTextStream>
+
+#include <memory>
+
+using namespace ps;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what, size_t memory)
+{
+	if (!condition) {
+		failures++;
+		QTextStream err(stderr);
+		err << memory << " bytes: " << what << "\n";
+		err.flush();
+	}
+}
+
+/**
+ * Whether @a move is a whole move of @a board (or ends the game).
+ */
+bool isMove(Board board, const Maybe<QVector<Direction>>& move)
+{
+	if (move.isNone()) {
+		return false;
+	}
+	for (Direction dir : move.get()) {
+		if (!board.canStepInDirection(dir)) {
+			return false;
+		}
+		board.pushStep(dir);
+	}
+	return board.winner().isSome() || board.canFinishMove();
+}
+
+/**
+ * Runs iterations until the tree stops growing.
+ */
+void fill(MonteCarloTree& tree, MonteCarloTree::Worker& worker)
+{
+	int nodes;
+	do {
+		nodes = tree.nodeCount();
+		for (int i = 0; i < 1000; i++) {
+			tree.iterate(worker);
+		}
+	} while (tree.nodeCount() != nodes);
+}
+
+/**
+ * Fills the arenas of a tree, then keeps the subtree of the best move, as the AI does
+ * between searches. The tree has a move to make in every position and grows again after
+ * it is advanced.
+ */
+void checkFullTree(size_t memory)
+{
+	Board board(QSize(8, 10));
+	std::unique_ptr<MonteCarloTree> tree(new MonteCarloTree(board, memory));
+	for (int move = 0; move < 6 && board.winner().isNone(); move++) {
+		MonteCarloTree::Worker worker(*tree, 0);
+		fill(*tree, worker);
+		Maybe<QVector<Direction>> best = tree->bestMove();
+		check(isMove(board, best), "no move from a full tree", memory);
+		if (best.isNone()) {
+			return;
+		}
+
+		for (Direction dir : best.get()) {
+			board.pushStep(dir);
+		}
+		if (board.winner().isNone()) {
+			board.finishMove();
+		}
+		if (!tree->advance(board, 2)) {
+			tree.reset(new MonteCarloTree(board, memory));
+			continue;
+		}
+
+		int nodes = tree->nodeCount();
+		MonteCarloTree::Worker next(*tree, 1);
+		for (int i = 0; i < 1000; i++) {
+			tree->iterate(next);
+		}
+		check(tree->nodeCount() > nodes || board.winner().isSome(), "the advanced tree doesn't grow", memory);
+	}
+}
+
+} // namespace
+
+/**
+ * Checks the Monte Carlo tree when its arenas are full.
+ */
+int main()
+{
+	// The root of a tree with a single node can't be expanded at all.
+	Board board(QSize(8, 10));
+	MonteCarloTree tiny(board, 1);
+	MonteCarloTree::Worker worker(tiny, 0);
+	for (int i = 0; i < 100; i++) {
+		tiny.iterate(worker);
+	}
+	check(isMove(board, tiny.bestMove()), "no move from an unexpanded root", 1);
+
+	for (size_t memory : {size_t(1) << 12, size_t(1) << 15, size_t(1) << 18}) {
+		checkFullTree(memory);
+	}
+	return failures == 0 ? 0 : 1;
+}
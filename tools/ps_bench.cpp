@@ -0,0 +1,427 @@
+#include "ps/models/board.hpp"
+#include "ps/shape.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTextStream>
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+
+using namespace ps;
+
+namespace {
+
+/**
+ * The number of allocations made by the process, counted by the replaced operator new.
+ */
+std::atomic<quint64> allocationCount(0);
+
+/**
+ * Counts and makes an allocation for the replaced operators new.
+ * @returns nullptr if there is no memory.
+ */
+void* allocate(size_t size)
+{
+	allocationCount++;
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+#ifdef __cpp_aligned_new
+void* allocate(size_t size, std::align_val_t alignment)
+{
+	// aligned_alloc needs a size which is a multiple of the alignment.
+	size_t align = static_cast<size_t>(alignment);
+	allocationCount++;
+	return std::aligned_alloc(align, (qMax<size_t>(size, 1) + align - 1) / align * align);
+}
+#endif
+
+/**
+ * Results of the benchmarks are added to it, so that the compiler can't drop them.
+ */
+volatile quint64 sink = 0;
+
+/**
+ * A position of the corpus: a board in the given phase of a game.
+ */
+struct Position
+{
+	QString phase;
+	Board board;
+};
+
+/**
+ * Makes a position of a random game with at least @a fraction of the edges visited, at the start
+ * of a turn. Steps ending the game are avoided.
+ * @returns none if a player got stuck, or the position has too many moves to enumerate
+ *          in a benchmark.
+ */
+Maybe<Board> randomPosition(QSize size, double fraction, quint32 seed)
+{
+	const quint64 maxMoves = 100000;
+
+	Board board(size);
+	std::mt19937 random(seed);
+	int edgeCount = 0;
+	for (const Edge& edge : board.edgesInside()) {
+		if (board.edgeCategory(edge) != EdgeCategory::Border) {
+			edgeCount++;
+		}
+	}
+
+	int visited = 0;
+	while (visited < fraction * edgeCount || !board.currentMove().empty()) {
+		if (board.canFinishMove()) {
+			board.finishMove();
+			continue;
+		}
+
+		Direction safe[8];
+		int count = 0;
+		for (Direction dir : directions) {
+			if (board.canStepInDirection(dir)) {
+				board.pushStep(dir);
+				if (board.winner().isNone()) {
+					safe[count++] = dir;
+				}
+				board.popStep();
+			}
+		}
+		if (count == 0) {
+			return none;
+		}
+		board.pushStep(safe[random() % count]);
+		visited++;
+	}
+
+	quint64 moves = 0;
+	bool enumerated = board.enumerateMoves([&] (Board&, Move) {
+		return ++moves < maxMoves;
+	});
+	if (!enumerated) {
+		return none;
+	}
+	return board;
+}
+
+/**
+ * The early, mid and late game positions of a board size. The games are random, but the seeds
+ * are fixed, so the corpus is the same in every run.
+ */
+QVector<Position> corpus(QSize size)
+{
+	QVector<Position> positions;
+	const char* const phases[] = {"early", "mid", "late"};
+	const double fractions[] = {0.05, 0.25, 0.5};
+	for (int i = 0; i < 3; i++) {
+		Maybe<Board> board{none};
+		for (quint32 seed = 1; board.isNone(); seed++) {
+			board = randomPosition(size, fractions[i], seed);
+		}
+		positions.append({phases[i], board.get()});
+	}
+	return positions;
+}
+
+struct Result
+{
+	double nsPerOp;
+	double allocationsPerOp;
+	quint64 ops;
+};
+
+/**
+ * Runs @a ops(n), which makes n operations, with n doubling until it takes at least
+ * @a minTime milliseconds.
+ */
+Result measure(std::function<void (quint64)> ops, qint64 minTime)
+{
+	for (quint64 count = 1; ; count *= 2) {
+		quint64 allocationsBefore = allocationCount;
+		QElapsedTimer timer;
+		timer.start();
+		ops(count);
+		qint64 elapsed = timer.nsecsElapsed();
+		if (elapsed >= minTime * 1000000) {
+			return {double(elapsed) / count, double(allocationCount - allocationsBefore) / count, count};
+		}
+	}
+}
+
+} // namespace
+
+// All replaceable allocation functions are replaced, so that every allocation is counted.
+
+void* operator new(size_t size)
+{
+	void* p = allocate(size);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* p = allocate(size, alignment);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+#endif
+
+/**
+ * Times the hot paths of Board on a fixed corpus of positions and prints the results as JSON.
+ */
+int main(int argc, char** argv)
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("ps_bench");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Times the hot paths of Board, prints ns/op and allocations/op as JSON.");
+	parser.addHelpOption();
+	QCommandLineOption timeOption({"t", "time"}, "The minimum time of one benchmark.", "ms", "100");
+	QCommandLineOption outputOption({"o", "output"}, "Write the results to a file instead of stdout.", "file");
+	parser.addOption(timeOption);
+	parser.addOption(outputOption);
+	parser.process(app);
+	qint64 minTime = qMax(1, parser.value(timeOption).toInt());
+
+	QJsonArray results;
+	for (QSize size : {QSize(8, 10), QSize(30, 30)}) {
+		for (Position& position : corpus(size)) {
+			Board& board = position.board;
+
+			// Inputs cycled through by the benchmarks, all points of the board and around it,
+			// all edges starting in them.
+			QVector<QPoint> points = board.pointsInside();
+			QVector<Edge> edges;
+			QVector<Shape<int, int, quint8>::KeysTuple> keys;
+			for (int x = -board.halfWidth() - 1; x <= board.halfWidth() + 1; x++) {
+				for (int y = -board.halfHeight() - 1; y <= board.halfHeight() + 1; y++) {
+					for (Direction dir : directions) {
+						edges.append(Edge(QPoint(x, y), dir));
+						keys.append(std::make_tuple(x, y, quint8(dir)));
+					}
+				}
+			}
+			Shape<int, int, quint8> shape(std::make_tuple(
+				std::make_pair(-board.halfWidth() - 1, board.halfWidth() + 1),
+				std::make_pair(-board.halfHeight() - 1, board.halfHeight() + 1),
+				std::make_pair(quint8(0), quint8(7))));
+			QVector<Direction> free;
+			for (Direction dir : directions) {
+				if (board.canStepInDirection(dir)) {
+					free.append(dir);
+				}
+			}
+
+			QVector<QPair<QString, std::function<void (quint64)>>> benchmarks = {
+				{"pushStep/popStep", [&] (quint64 n) {
+					for (quint64 i = 0; i < n; i++) {
+						board.pushStep(free[i % free.size()]);
+						board.popStep();
+					}
+				}},
+				{"canStepInDirection", [&] (quint64 n) {
+					quint64 sum = 0;
+					for (quint64 i = 0; i < n; i++) {
+						sum += board.canStepInDirection(directions[i % 8]);
+					}
+					sink += sum;
+				}},
+				{"countVisitedEdgesAround", [&] (quint64 n) {
+					quint64 sum = 0;
+					for (quint64 i = 0; i < n; i++) {
+						sum += board.countVisitedEdgesAround(points[i % points.size()]);
+					}
+					sink += sum;
+				}},
+				{"winner", [&] (quint64 n) {
+					quint64 sum = 0;
+					for (quint64 i = 0; i < n; i++) {
+						sum += board.winner().isSome();
+					}
+					sink += sum;
+				}},
+				{"enumerateMoves", [&] (quint64 n) {
+					quint64 sum = 0;
+					for (quint64 i = 0; i < n; i++) {
+						board.enumerateMoves([&] (Board&, Move move) {
+							sum += move.size();
+							return true;
+						});
+					}
+					sink += sum;
+				}},
+				{"isEdgeInside", [&] (quint64 n) {
+					quint64 sum = 0;
+					for (quint64 i = 0; i < n; i++) {
+						sum += board.isEdgeInside(edges[i % edges.size()]);
+					}
+					sink += sum;
+				}},
+				{"Edge::normalize", [&] (quint64 n) {
+					quint64 sum = 0;
+					for (quint64 i = 0; i < n; i++) {
+						Edge edge = edges[i % edges.size()];
+						edge.normalize();
+						sum += edge.start().x() + edge.direction();
+					}
+					sink += sum;
+				}},
+				{"Shape::map", [&] (quint64 n) {
+					quint64 sum = 0;
+					for (quint64 i = 0; i < n; i++) {
+						sum += shape.map(keys[i % keys.size()]);
+					}
+					sink += sum;
+				}},
+				{"Board copy", [&] (quint64 n) {
+					quint64 sum = 0;
+					for (quint64 i = 0; i < n; i++) {
+						Board copy(board);
+						sum += copy.hash();
+					}
+					sink += sum;
+				}},
+			};
+
+			QString boardName = QStringLiteral("%1x%2").arg(size.width()).arg(size.height());
+			for (const auto& benchmark : benchmarks) {
+				Result result = measure(benchmark.second, minTime);
+				QJsonObject object;
+				object["benchmark"] = benchmark.first;
+				object["board"] = boardName;
+				object["phase"] = position.phase;
+				object["ns_per_op"] = result.nsPerOp;
+				object["allocs_per_op"] = result.allocationsPerOp;
+				object["ops"] = double(result.ops);
+				results.append(object);
+			}
+		}
+	}
+
+	QJsonObject root;
+	root["version"] = 1;
+	root["min_time_ms"] = double(minTime);
+	root["results"] = results;
+	QByteArray json = QJsonDocument(root).toJson();
+
+	if (parser.isSet(outputOption)) {
+		QFile file(parser.value(outputOption));
+		if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+			QTextStream err(stderr);
+			err << "Cannot write " << file.fileName() << "\n";
+			err.flush();
+			return 1;
+		}
+	} else {
+		QTextStream out(stdout);
+		out << json;
+		out.flush();
+	}
+	return 0;
+}
@@ -0,0 +1,80 @@
+#include "ps/engine/openingbookbuilder.hpp"
+#include "ps/models/gameconfig.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+
+using namespace ps;
+
+/**
+ * Builds an opening book from games of the AI against itself.
+ */
+int main(int argc, char** argv)
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("ps_book");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Builds an opening book from games of the AI against itself.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("file", "The book file to write (*.psb).");
+	QCommandLineOption sizeOption({"s", "size"}, "The board size.", "WxH", "8x10");
+	QCommandLineOption gamesOption({"g", "games"}, "The number of games.", "count", "100");
+	QCommandLineOption turnsOption({"b", "book-depth"}, "The number of turns in the book.", "turns", "8");
+	QCommandLineOption depthOption({"d", "depth"}, "The depth limit of the AI.", "steps",
+		QString::number(AIConfig().depthLimit()));
+	QCommandLineOption timeOption({"t", "time"}, "The time limit of the AI per move.", "ms", "1000");
+	QCommandLineOption seedOption("seed", "The seed of the random turns.", "seed", "1");
+	parser.addOption(sizeOption);
+	parser.addOption(gamesOption);
+	parser.addOption(turnsOption);
+	parser.addOption(depthOption);
+	parser.addOption(timeOption);
+	parser.addOption(seedOption);
+	parser.process(app);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	if (parser.positionalArguments().size() != 1) {
+		parser.showHelp(1);
+	}
+
+	QStringList size = parser.value(sizeOption).split('x');
+	int width = size.value(0).toInt();
+	int height = size.value(1).toInt();
+	if (size.size() != 2 || width < GameConfig::minSize || width > GameConfig::maxSize
+		|| height < GameConfig::minSize || height > GameConfig::maxSize
+		|| width % 2 != 0 || height % 2 != 0) {
+		err << "The size must be even and between " << GameConfig::minSize << " and "
+			<< GameConfig::maxSize << "\n";
+		err.flush();
+		return 1;
+	}
+
+	AIConfig config;
+	config.setDepthLimit(qBound(1, parser.value(depthOption).toInt(), AIConfig::maxDepth));
+	config.setTimeLimit(qBound(AIConfig::minTimeLimit, parser.value(timeOption).toInt(), AIConfig::maxTimeLimit));
+
+	QElapsedTimer timer;
+	timer.start();
+	OpeningBookBuilder builder(QSize(width, height), config, parser.value(turnsOption).toInt(),
+		parser.value(seedOption).toULongLong());
+	builder.setLog([&] (const QString& message) {
+		out << timer.elapsed() << " ms: " << message << "\n";
+		out.flush();
+	});
+	builder.play(parser.value(gamesOption).toInt());
+
+	QString fileName = parser.positionalArguments().first();
+	if (!builder.write(fileName)) {
+		err << builder.errorString() << "\n";
+		err.flush();
+		return 1;
+	}
+	out << "Wrote " << builder.positionCount() << " positions to " << fileName << "\n";
+	out.flush();
+	return 0;
+}
@@ -0,0 +1,328 @@
+#include "ps/ai.hpp"
+#include "ps/models/gameconfig.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QRunnable>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtCore/QThreadPool>
+
+#include <functional>
+#include <mutex>
+
+using namespace ps;
+
+namespace {
+
+class Task : public QRunnable
+{
+public:
+	explicit Task(std::function<void ()> f)
+		: f(f)
+	{
+	}
+
+	void run() override
+	{
+		f();
+	}
+
+private:
+	std::function<void ()> f;
+};
+
+/**
+ * QString::split's flag dropping empty parts, it moved to the Qt namespace in Qt 5.14.
+ */
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+const Qt::SplitBehavior skipEmptyParts = Qt::SkipEmptyParts;
+#else
+const QString::SplitBehavior skipEmptyParts = QString::SkipEmptyParts;
+#endif
+
+const char* const directionNames[] = {"NW", "N", "NE", "E", "SE", "S", "SW", "W"};
+
+/**
+ * Formats a turn as its steps separated by dashes, e.g. "N-NE-E".
+ */
+QString turnName(const QVector<Direction>& turn)
+{
+	QStringList steps;
+	for (Direction dir : turn) {
+		steps.append(directionNames[dir]);
+	}
+	return steps.join('-');
+}
+
+/**
+ * Makes a turn written like turnName on @a board.
+ * @returns false if the turn is not a legal turn, the board is left in an unspecified state then.
+ */
+bool makeTurn(Board& board, const QString& turn)
+{
+	for (const QString& step : turn.split('-')) {
+		int dir = 0;
+		while (dir < 8 && step != directionNames[dir]) {
+			dir++;
+		}
+		if (dir == 8 || board.winner().isSome() || !board.canStepInDirection(directions[dir])) {
+			return false;
+		}
+		board.pushStep(directions[dir]);
+	}
+
+	if (board.winner().isSome()) {
+		return true;
+	} else if (board.canFinishMove()) {
+		board.endMove();
+		return true;
+	}
+	return false;
+}
+
+/**
+ * The engine side of the protocol: keeps the game, runs searches in the background
+ * and writes the responses.
+ */
+class Engine
+{
+public:
+	Engine()
+		: output(stdout)
+		, board(QSize(8, 10))
+		, startingBoard(board)
+	{
+		config.setThreadCount(1);
+		pool.setMaxThreadCount(1);
+	}
+
+	~Engine()
+	{
+		stop();
+	}
+
+	/**
+	 * Handles a command line.
+	 * @returns false after quit.
+	 */
+	bool handle(const QString& line)
+	{
+		QStringList args = line.split(' ', skipEmptyParts);
+		if (args.isEmpty()) {
+			return true;
+		}
+		QString command = args.takeFirst();
+
+		if (command == "uci") {
+			send("id name ps_engine");
+			send("uciok");
+		} else if (command == "isready") {
+			send("readyok");
+		} else if (command == "setoption") {
+			setOption(args);
+		} else if (command == "newgame") {
+			newGame(args);
+		} else if (command == "position") {
+			position(args);
+		} else if (command == "go") {
+			go(args);
+		} else if (command == "stop") {
+			stop();
+		} else if (command == "quit") {
+			stop();
+			return false;
+		} else {
+			send(QStringLiteral("info string unknown command %1").arg(command));
+		}
+		return true;
+	}
+
+private:
+	/**
+	 * setoption name <name> value <value>, with the names of AIConfig::setOption.
+	 */
+	void setOption(const QStringList& args)
+	{
+		int valueIndex = args.indexOf("value");
+		QString name = args.mid(1, valueIndex < 0 ? -1 : valueIndex - 1).join(' ');
+		QString value = valueIndex < 0 ? QString() : args.mid(valueIndex + 1).join(' ');
+		if (args.value(0) != "name" || !config.setOption(name, value)) {
+			send(QStringLiteral("info string invalid option %1").arg(args.join(' ')));
+		}
+	}
+
+	/**
+	 * newgame <width> <height>
+	 */
+	void newGame(const QStringList& args)
+	{
+		bool widthOk, heightOk;
+		int width = args.value(0).toInt(&widthOk);
+		int height = args.value(1).toInt(&heightOk);
+		if (args.size() != 2 || !widthOk || !heightOk
+			|| width < GameConfig::minSize || width > GameConfig::maxSize
+			|| height < GameConfig::minSize || height > GameConfig::maxSize
+			|| width % 2 != 0 || height % 2 != 0) {
+			send(QStringLiteral("info string the size must be even and between %1 and %2")
+				.arg(GameConfig::minSize).arg(GameConfig::maxSize));
+			return;
+		}
+
+		stop();
+		board = Board(QSize(width, height));
+		startingBoard = board;
+	}
+
+	/**
+	 * position <turn>... with the turns made from the start of the game.
+	 */
+	void position(const QStringList& args)
+	{
+		stop();
+		Board next = startingBoard;
+		for (const QString& turn : args) {
+			if (next.winner().isSome() || !makeTurn(next, turn)) {
+				send(QStringLiteral("info string illegal turn %1").arg(turn));
+				return;
+			}
+		}
+		board = next;
+	}
+
+	/**
+	 * go [movetime <ms>] [depth <depth>] [nodes <count>], the limits of the config if none
+	 * is given.
+	 */
+	void go(const QStringList& args)
+	{
+		stop();
+		AIConfig searchConfig = config;
+		quint64 nodeLimit = 0;
+		if (!args.isEmpty()) {
+			searchConfig.setTimeLimit(AIConfig::maxTimeLimit);
+			searchConfig.setDepthLimit(AIConfig::maxDepth);
+		}
+		for (int i = 0; i + 1 < args.size(); i += 2) {
+			qint64 value = args[i + 1].toLongLong();
+			if (args[i] == "movetime") {
+				searchConfig.setTimeLimit(int(qBound<qint64>(AIConfig::minTimeLimit, value, AIConfig::maxTimeLimit)));
+			} else if (args[i] == "depth") {
+				searchConfig.setDepthLimit(int(qBound<qint64>(1, value, AIConfig::maxDepth)));
+			} else if (args[i] == "nodes") {
+				nodeLimit = quint64(qMax<qint64>(1, value));
+			}
+		}
+
+		if (board.winner().isSome()) {
+			send("bestmove (none)");
+			return;
+		}
+
+		token = CancellationToken();
+		CancellationToken searchToken = token;
+		Board searchBoard = board;
+		pool.start(new Task([this, searchConfig, nodeLimit, searchToken, searchBoard] () mutable {
+			ai.setNodeLimit(nodeLimit);
+			ai.setProgress([this] (const AI::Progress& progress) {
+				sendProgress(progress);
+			});
+			Maybe<Board> result = ai.search(searchBoard, searchConfig, searchToken);
+
+			// A search stopped before the first iteration has no move, any move will do then.
+			QVector<Direction> move;
+			if (result.isSome()) {
+				move = result.get().currentMove().toVector();
+			} else {
+				searchBoard.enumerateMoves([&] (Board&, Move first) {
+					move = first.toVector();
+					return false;
+				});
+			}
+			send(QStringLiteral("bestmove %1").arg(turnName(move)));
+		}));
+	}
+
+	/**
+	 * Stops the search, if there is one, and waits for its bestmove.
+	 */
+	void stop()
+	{
+		token.cancel();
+		pool.waitForDone();
+	}
+
+	void sendProgress(const AI::Progress& progress)
+	{
+		QStringList line{"info"};
+		if (progress.depth > 0) {
+			line << "depth" << QString::number(progress.depth);
+		}
+		if (progress.value.isSome()) {
+			int value = progress.value.get();
+			line << "score" << (value >= AI::winValue ? QStringLiteral("win")
+				: value <= -AI::winValue ? QStringLiteral("loss") : QString::number(value));
+		}
+		line << "nodes" << QString::number(progress.nodes)
+			<< "nps" << QString::number(progress.nodes * 1000 / quint64(qMax<qint64>(1, progress.milliseconds)))
+			<< "time" << QString::number(progress.milliseconds)
+			<< "pv";
+		for (const QVector<Direction>& turn : progress.principalVariation) {
+			line << turnName(turn);
+		}
+		send(line.join(' '));
+	}
+
+	/**
+	 * Writes a line, from the main thread or the search.
+	 */
+	void send(const QString& line)
+	{
+		std::lock_guard<std::mutex> lock(outputMutex);
+		// The other side waits for each response, it can't stay in the buffer.
+		output << line << "\n";
+		output.flush();
+	}
+
+	std::mutex outputMutex;
+	QTextStream output;
+
+	AIConfig config;
+	Board board;
+	Board startingBoard;
+
+	/**
+	 * Used by the search thread only, while a search runs.
+	 */
+	AI ai;
+	QThreadPool pool;
+	CancellationToken token;
+};
+
+} // namespace
+
+/**
+ * Plays as an engine over a line-based protocol in the style of UCI, on stdin and stdout.
+ *
+ * Commands: uci, isready, setoption name <name> value <value> (see AIConfig::setOption),
+ * newgame <width> <height>, position <turn>..., go [movetime <ms>] [depth <depth>]
+ * [nodes <count>], stop and quit. A turn is written as its steps, e.g. "N-NE-E".
+ * The search reports its iterations as "info depth <d> score <value|win|loss> nodes <n>
+ * nps <n> time <ms> pv <turn>..." and ends with "bestmove <turn>".
+ */
+int main(int argc, char** argv)
+{
+	QCoreApplication app(argc, argv);
+	// The same names as the game, so the AI finds the tablebases generated for it.
+	QCoreApplication::setOrganizationName("No organization");
+	QCoreApplication::setOrganizationDomain("pn347193.students.mimuw.edu.pl");
+	QCoreApplication::setApplicationName("Paper soccer");
+
+	Engine engine;
+	QTextStream input(stdin);
+	for (QString line = input.readLine(); !line.isNull(); line = input.readLine()) {
+		if (!engine.handle(line.trimmed())) {
+			break;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,203 @@
+#include "ps/models/gameconfig.hpp"
+#include "ps/models/history.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+
+using namespace ps;
+
+namespace {
+
+/**
+ * Counts of the turn sequences of one length.
+ */
+struct PlyCounts
+{
+	/**
+	 * The number of turn sequences of this length.
+	 */
+	quint64 turns = 0;
+
+	/**
+	 * The total number of steps in the last turns of the sequences.
+	 */
+	quint64 steps = 0;
+
+	/**
+	 * The number of sequences whose last turn ended the game.
+	 */
+	quint64 finished = 0;
+};
+
+/**
+ * Enumerates all turn sequences of at most @a depth turns from @a board, adding them
+ * to @a counts, indexed by the length of the sequence minus one. Sequences end early if the
+ * game is over.
+ * @returns the number of leaves: sequences of @a depth turns or ending the game.
+ */
+quint64 perft(Board& board, int depth, QVector<PlyCounts>& counts, int ply = 0)
+{
+	if (depth == 0 || board.winner().isSome()) {
+		return 1;
+	}
+
+	quint64 leaves = 0;
+	PlyCounts& plyCounts = counts[ply];
+	board.enumerateMoves([&] (Board& child, Move move) {
+		plyCounts.turns++;
+		plyCounts.steps += move.size();
+		if (child.winner().isSome()) {
+			plyCounts.finished++;
+		}
+		leaves += perft(child, depth - 1, counts, ply + 1);
+		return true;
+	});
+	return leaves;
+}
+
+} // namespace
+
+/**
+ * Counts all turn sequences to a given depth, as a reference count and a benchmark
+ * of the move generator.
+ */
+int main(int argc, char** argv)
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("ps_perft");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Counts all turn sequences to a given depth with Board::enumerateMoves.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("file", "A saved game (*.pss), a new board of the given size if omitted.", "[file]");
+	QCommandLineOption depthOption({"d", "depth"}, "The number of turns.", "turns", "2");
+	QCommandLineOption sizeOption({"s", "size"}, "The size of a new board.", "WxH", "8x10");
+	QCommandLineOption indexOption({"i", "index"}, "The history entry to start from (the focused one by default).", "index");
+	QCommandLineOption divideOption("divide", "Print the number of leaves after each first turn.");
+	QCommandLineOption expectOption("expect", "Fail if the number of leaves is different, for regression tests.", "leaves");
+	parser.addOption(depthOption);
+	parser.addOption(sizeOption);
+	parser.addOption(indexOption);
+	parser.addOption(divideOption);
+	parser.addOption(expectOption);
+	parser.process(app);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	if (parser.positionalArguments().size() > 1) {
+		parser.showHelp(1);
+	}
+
+	Board board;
+	if (parser.positionalArguments().isEmpty()) {
+		QStringList size = parser.value(sizeOption).split('x');
+		int width = size.value(0).toInt();
+		int height = size.value(1).toInt();
+		if (size.size() != 2 || width < GameConfig::minSize || width > GameConfig::maxSize
+			|| height < GameConfig::minSize || height > GameConfig::maxSize
+			|| width % 2 != 0 || height % 2 != 0) {
+			err << "The size must be even and between " << GameConfig::minSize << " and "
+				<< GameConfig::maxSize << "\n";
+			err.flush();
+			return 1;
+		}
+		board = Board(QSize(width, height));
+	} else {
+		QFile file(parser.positionalArguments().first());
+		if (!file.open(QIODevice::ReadOnly)) {
+			err << "Cannot open " << file.fileName() << "\n";
+			err.flush();
+			return 1;
+		}
+
+		GameConfig config;
+		History history;
+		QDataStream stream(&file);
+		stream >> config >> history;
+		if (stream.status() != QDataStream::Ok || history.size() == 0) {
+			err << "The save file is invalid\n";
+			err.flush();
+			return 1;
+		}
+
+		int index = history.focusedIndex().isSome() ? history.focusedIndex().get() : history.size() - 1;
+		if (parser.isSet(indexOption)) {
+			index = parser.value(indexOption).toInt();
+		}
+		if (index < 0 || index >= history.size()) {
+			err << "The index must be between 0 and " << history.size() - 1 << "\n";
+			err.flush();
+			return 1;
+		}
+		board = *history.boardAt(index);
+	}
+
+	int depth = parser.value(depthOption).toInt();
+	if (depth < 1) {
+		err << "The depth must be at least 1\n";
+		err.flush();
+		return 1;
+	}
+	if (board.winner().isSome()) {
+		err << "The game is over\n";
+		err.flush();
+		return 1;
+	}
+
+	static const char* const names[] = {"NW", "N", "NE", "E", "SE", "S", "SW", "W"};
+	QVector<PlyCounts> counts(depth);
+	quint64 leaves = 0;
+	// The leaves after each first turn are printed after the timer stops, so that the output
+	// isn't timed.
+	QVector<QPair<QVector<Direction>, quint64>> divided;
+	QElapsedTimer timer;
+	timer.start();
+	if (parser.isSet(divideOption)) {
+		board.enumerateMoves([&] (Board& child, Move move) {
+			counts[0].turns++;
+			counts[0].steps += move.size();
+			if (child.winner().isSome()) {
+				counts[0].finished++;
+			}
+			quint64 moveLeaves = perft(child, depth - 1, counts, 1);
+			leaves += moveLeaves;
+			divided.append({move.toVector(), moveLeaves});
+			return true;
+		});
+	} else {
+		leaves = perft(board, depth, counts);
+	}
+	qint64 elapsed = qMax(timer.nsecsElapsed(), qint64(1));
+
+	for (const auto& turn : divided) {
+		for (int i = 0; i < turn.first.size(); i++) {
+			out << (i == 0 ? "" : " ") << names[turn.first[i]];
+		}
+		out << ": " << turn.second << "\n";
+	}
+
+	quint64 turns = 0;
+	quint64 steps = 0;
+	for (int ply = 0; ply < depth; ply++) {
+		out << "depth " << ply + 1 << ": " << counts[ply].turns << " turns, " << counts[ply].steps
+			<< " steps, " << counts[ply].finished << " finished games\n";
+		turns += counts[ply].turns;
+		steps += counts[ply].steps;
+	}
+	out << "leaves: " << leaves << "\n";
+	out << "time: " << elapsed / 1000000 << " ms\n";
+	out << "nodes/s: " << quint64(turns * 1e9 / elapsed) << "\n";
+	out << "steps/s: " << quint64(steps * 1e9 / elapsed) << "\n";
+	out.flush();
+
+	if (parser.isSet(expectOption) && parser.value(expectOption).toULongLong() != leaves) {
+		err << "Expected " << parser.value(expectOption) << " leaves\n";
+		err.flush();
+		return 1;
+	}
+	return 0;
+}
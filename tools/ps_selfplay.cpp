@@ -0,0 +1,402 @@
+#include "ps/ai.hpp"
+#include "ps/engine/openingbook.hpp"
+#include "ps/models/gameconfig.hpp"
+#include "ps/models/history.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QRunnable>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <random>
+
+using namespace ps;
+
+namespace {
+
+class Task : public QRunnable
+{
+public:
+	explicit Task(std::function<void ()> f)
+		: f(f)
+	{
+	}
+
+	void run() override
+	{
+		f();
+	}
+
+private:
+	std::function<void ()> f;
+};
+
+/**
+ * QString::split's flag dropping empty parts, it moved to the Qt namespace in Qt 5.14.
+ */
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+const Qt::SplitBehavior skipEmptyParts = Qt::SkipEmptyParts;
+#else
+const QString::SplitBehavior skipEmptyParts = QString::SkipEmptyParts;
+#endif
+
+/**
+ * Parses an engine configuration, comma separated key=value pairs, for example
+ * "engine=alphabeta,evaluation=goaldistance,depth=8,time=500".
+ * @returns none and sets @a error if a key or a value is invalid.
+ */
+Maybe<AIConfig> parseConfig(const QString& text, QString& error)
+{
+	AIConfig config;
+	config.setThreadCount(1);
+	for (const QString& pair : text.split(',', skipEmptyParts)) {
+		if (!config.setOption(pair.section('=', 0, 0).trimmed(), pair.section('=', 1).trimmed())) {
+			error = QStringLiteral("Invalid engine option: %1").arg(pair);
+			return none;
+		}
+	}
+	return config;
+}
+
+/**
+ * A random move which doesn't end the game, if there is one.
+ */
+QVector<Direction> randomMove(Board& board, std::mt19937_64& random)
+{
+	// Reservoir sampling, the number of moves is not known in advance.
+	QVector<Direction> chosen;
+	quint64 count = 0;
+	bool ending = true;
+	board.enumerateMoves([&] (Board& child, Move move) {
+		bool childEnding = child.winner().isSome();
+		if (childEnding && !ending) {
+			return true;
+		}
+		if (ending && !childEnding) {
+			ending = false;
+			count = 0;
+		}
+		count++;
+		if (random() % count == 0) {
+			chosen = move.toVector();
+		}
+		return true;
+	});
+	return chosen;
+}
+
+/**
+ * The result of a game from the point of view of the first engine.
+ */
+enum class Outcome
+{
+	Win,
+	Draw,
+	Loss
+};
+
+/**
+ * Win, draw and loss counts of the first engine, with the statistics of the match.
+ */
+struct Score
+{
+	int wins = 0;
+	int draws = 0;
+	int losses = 0;
+
+	int games() const
+	{
+		return wins + draws + losses;
+	}
+
+	/**
+	 * The mean score of a game, a win is 1 and a draw is 1/2.
+	 */
+	double mean() const
+	{
+		return (wins + draws / 2.0) / games();
+	}
+
+	/**
+	 * The variance of the score of a game.
+	 */
+	double variance() const
+	{
+		double m = mean();
+		return (wins * (1 - m) * (1 - m) + draws * (0.5 - m) * (0.5 - m) + losses * m * m) / games();
+	}
+
+	/**
+	 * The log-likelihood ratio of the hypotheses that the Elo difference is @a elo1 rather
+	 * than @a elo0, in the normal approximation used by chess engine testing.
+	 */
+	double llr(double elo0, double elo1) const
+	{
+		double var = variance();
+		if (var == 0) {
+			return 0;
+		}
+		double s0 = expectedScore(elo0);
+		double s1 = expectedScore(elo1);
+		return games() * (s1 - s0) * (2 * mean() - s0 - s1) / (2 * var);
+	}
+
+	static double expectedScore(double elo)
+	{
+		return 1 / (1 + std::pow(10, -elo / 400));
+	}
+
+	static double elo(double score)
+	{
+		score = qBound(1e-6, score, 1 - 1e-6);
+		return -400 * std::log10(1 / score - 1);
+	}
+};
+
+/**
+ * The half-width of the 95% confidence interval of a mean of @a n samples with @a variance.
+ */
+double confidence(double variance, int n)
+{
+	return 1.96 * std::sqrt(variance / n);
+}
+
+} // namespace
+
+/**
+ * Plays games between two engine configurations and reports the score of the first one.
+ */
+int main(int argc, char** argv)
+{
+	QCoreApplication app(argc, argv);
+	// The same names as the game, so the engines find the tablebases generated for it.
+	QCoreApplication::setOrganizationName("No organization");
+	QCoreApplication::setOrganizationDomain("pn347193.students.mimuw.edu.pl");
+	QCoreApplication::setApplicationName("Paper soccer");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Plays games between two engine configurations, given as comma separated "
+		"key=value pairs: engine (alphabeta, lazysmp, montecarlo), evaluation (ballrow, goaldistance), "
+		"time, depth, table, threads, playouts, pvs (on, off), aspiration (on, off), book.");
+	parser.addHelpOption();
+	QCommandLineOption firstOption({"a", "first"}, "The first engine.", "config", "");
+	QCommandLineOption secondOption({"b", "second"}, "The second engine.", "config", "");
+	QCommandLineOption sizeOption({"s", "size"}, "The board size.", "WxH", "8x10");
+	QCommandLineOption gamesOption({"g", "games"}, "The number of games.", "count", "1000");
+	QCommandLineOption concurrencyOption({"c", "concurrency"}, "The number of games played at once.", "count",
+		QString::number(qMax(1, QThread::idealThreadCount())));
+	QCommandLineOption openingTurnsOption("opening-turns", "The number of opening turns.", "turns", "2");
+	QCommandLineOption bookOption("book", "Take the opening turns from a book instead of random ones.", "file");
+	QCommandLineOption maxTurnsOption("max-turns", "Adjudicate a game as a draw after this many turns.",
+		"turns", "1000");
+	QCommandLineOption sprtOption("sprt", "Stop when a sequential probability ratio test accepts "
+		"one of the Elo differences.", "elo0,elo1");
+	QCommandLineOption alphaOption("alpha", "The false positive rate of the test.", "rate", "0.05");
+	QCommandLineOption betaOption("beta", "The false negative rate of the test.", "rate", "0.05");
+	QCommandLineOption seedOption("seed", "The seed of the openings.", "seed", "1");
+	QCommandLineOption outputOption({"o", "output"}, "Save the games to this directory.", "dir");
+	parser.addOptions({firstOption, secondOption, sizeOption, gamesOption, concurrencyOption, openingTurnsOption,
+		bookOption, maxTurnsOption, sprtOption, alphaOption, betaOption, seedOption, outputOption});
+	parser.process(app);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+
+	QString error;
+	Maybe<AIConfig> configs[2] = {parseConfig(parser.value(firstOption), error), none};
+	if (configs[0].isSome()) {
+		configs[1] = parseConfig(parser.value(secondOption), error);
+	}
+	if (configs[1].isNone()) {
+		err << error << "\n";
+		err.flush();
+		return 1;
+	}
+
+	QStringList size = parser.value(sizeOption).split('x');
+	int width = size.value(0).toInt();
+	int height = size.value(1).toInt();
+	if (size.size() != 2 || width < GameConfig::minSize || width > GameConfig::maxSize
+		|| height < GameConfig::minSize || height > GameConfig::maxSize
+		|| width % 2 != 0 || height % 2 != 0) {
+		err << "The size must be even and between " << GameConfig::minSize << " and "
+			<< GameConfig::maxSize << "\n";
+		err.flush();
+		return 1;
+	}
+	QSize boardSize(width, height);
+
+	OpeningBook book;
+	if (parser.isSet(bookOption)) {
+		if (!book.open(parser.value(bookOption)) || book.size() != boardSize) {
+			err << "Cannot open a book of a " << width << "x" << height << " board: "
+				<< parser.value(bookOption) << "\n";
+			err.flush();
+			return 1;
+		}
+	}
+
+	bool sprt = parser.isSet(sprtOption);
+	double elo0 = parser.value(sprtOption).section(',', 0, 0).toDouble();
+	double elo1 = parser.value(sprtOption).section(',', 1, 1).toDouble();
+	double alpha = parser.value(alphaOption).toDouble();
+	double beta = parser.value(betaOption).toDouble();
+	if (sprt && (elo0 >= elo1 || alpha <= 0 || alpha >= 1 || beta <= 0 || beta >= 1)) {
+		err << "The test needs elo0 < elo1 and rates between 0 and 1\n";
+		err.flush();
+		return 1;
+	}
+	double lowerBound = std::log(beta / (1 - alpha));
+	double upperBound = std::log((1 - beta) / alpha);
+
+	QDir outputDir(parser.value(outputOption));
+	if (parser.isSet(outputOption) && !QDir().mkpath(outputDir.path())) {
+		err << "Cannot create " << outputDir.path() << "\n";
+		err.flush();
+		return 1;
+	}
+
+	int gameCount = qMax(1, parser.value(gamesOption).toInt());
+	int concurrency = qBound(1, parser.value(concurrencyOption).toInt(), gameCount);
+	int openingTurns = qMax(0, parser.value(openingTurnsOption).toInt());
+	int maxTurns = qMax(1, parser.value(maxTurnsOption).toInt());
+	quint64 seed = parser.value(seedOption).toULongLong();
+
+	Score score;
+	std::mutex mutex;
+	std::atomic<int> nextGame(0);
+	CancellationToken stop;
+
+	// Games 2k and 2k + 1 start from the same opening with the engines swapped, so that
+	// neither engine gets the better side of more openings.
+	auto play = [&] (AI (&ais)[2], int game) {
+		int firstEngine = game % 2;
+		std::mt19937_64 random(seed + game / 2);
+		GameConfig gameConfig;
+		gameConfig.setSize(boardSize);
+		for (Player player : {Player::One, Player::Two}) {
+			gameConfig.setPlayerHuman(player, false);
+			gameConfig.setAIConfig(player, configs[static_cast<int>(player) ^ firstEngine].get());
+		}
+
+		History history;
+		history.push(Board(boardSize));
+		int turn = 0;
+		for (; turn < maxTurns; turn++) {
+			Board& board = *history.boardAt(history.size() - 1);
+			QVector<Direction> move;
+			if (turn < openingTurns) {
+				Maybe<Move> bookMove = book.isOpen() ? book.choose(board, random()) : none;
+				move = bookMove.isSome() ? bookMove.get().toVector() : randomMove(board, random);
+			} else {
+				int engine = static_cast<int>(board.currentPlayer()) ^ firstEngine;
+				Maybe<Board> result = ais[engine].search(board, configs[engine].get(), stop);
+				if (result.isNone()) {
+					return;
+				}
+				move = result.get().currentMove().toVector();
+			}
+
+			// Saved the way the game does: the board keeps the move made from it, the finished
+			// move is the next entry.
+			board.setCurrentMove(move);
+			if (board.winner().isSome()) {
+				break;
+			}
+			Board next(board);
+			next.finishMove();
+			history.push(next);
+		}
+		history.focusLast();
+		if (stop.isCancelled()) {
+			return;
+		}
+
+		Maybe<Player> winner = history.boardAt(history.size() - 1)->winner();
+		Outcome outcome = winner.isNone() ? Outcome::Draw
+			: (static_cast<int>(winner.get()) ^ firstEngine) == 0 ? Outcome::Win : Outcome::Loss;
+
+		if (parser.isSet(outputOption)) {
+			QFile file(outputDir.filePath(QStringLiteral("game-%1.pss").arg(game + 1, 5, 10, QChar('0'))));
+			QDataStream stream(&file);
+			if (file.open(QIODevice::WriteOnly)) {
+				stream << gameConfig << history;
+			}
+			if (stream.status() != QDataStream::Ok) {
+				std::lock_guard<std::mutex> lock(mutex);
+				err << "Cannot write " << file.fileName() << "\n";
+				err.flush();
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stop.isCancelled()) {
+			return;
+		}
+		static const char* const results[] = {"first engine won", "draw", "second engine won"};
+		switch (outcome) {
+			case Outcome::Win: score.wins++; break;
+			case Outcome::Draw: score.draws++; break;
+			case Outcome::Loss: score.losses++; break;
+		}
+		out << "Game " << game + 1 << ": " << results[static_cast<int>(outcome)] << " after "
+			<< qMin(turn + 1, maxTurns) << " turns, +" << score.wins << " =" << score.draws << " -" << score.losses;
+		if (sprt) {
+			double llr = score.llr(elo0, elo1);
+			out << ", LLR " << llr << " [" << lowerBound << ", " << upperBound << "]";
+			if (llr <= lowerBound || llr >= upperBound) {
+				stop.cancel();
+			}
+		}
+		out << "\n";
+		out.flush();
+	};
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(concurrency);
+	for (int i = 0; i < concurrency; i++) {
+		pool.start(new Task([&] () {
+			// The engines keep their tables between the games of a thread.
+			AI ais[2];
+			for (int game = nextGame++; game < gameCount && !stop.isCancelled(); game = nextGame++) {
+				play(ais, game);
+			}
+		}));
+	}
+	pool.waitForDone();
+
+	int n = score.games();
+	if (n == 0) {
+		err << "No games were finished\n";
+		err.flush();
+		return 1;
+	}
+	double mean = score.mean();
+	double scoreError = confidence(score.variance(), n);
+	double winRate = double(score.wins) / n;
+	double drawRate = double(score.draws) / n;
+	out << "\nGames: " << n << "\n";
+	out << "First engine: +" << score.wins << " =" << score.draws << " -" << score.losses << "\n";
+	out << "Win rate: " << 100 * winRate << "% +- " << 100 * confidence(winRate * (1 - winRate), n) << "%\n";
+	out << "Draw rate: " << 100 * drawRate << "% +- " << 100 * confidence(drawRate * (1 - drawRate), n)
+		<< "%\n";
+	out << "Score: " << 100 * mean << "% +- " << 100 * scoreError << "%\n";
+	out << "Elo difference: " << Score::elo(mean) << " [" << Score::elo(mean - scoreError) << ", "
+		<< Score::elo(mean + scoreError) << "]\n";
+	if (sprt) {
+		double llr = score.llr(elo0, elo1);
+		out << "SPRT: " << (llr >= upperBound ? "H1 accepted" : llr <= lowerBound ? "H0 accepted" : "inconclusive")
+			<< " (LLR " << llr << ")\n";
+	}
+	out.flush();
+	return 0;
+}
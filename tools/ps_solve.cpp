@@ -0,0 +1,91 @@
+#include "ps/solver.hpp"
+#include "ps/models/gameconfig.hpp"
+#include "ps/models/history.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
+using namespace ps;
+
+/**
+ * Solves a position of a saved game without the GUI and prints the result.
+ */
+int main(int argc, char** argv)
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("ps_solve");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Proves or disproves a forced win of the player on move.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("file", "A saved game (*.pss).");
+	QCommandLineOption indexOption({"i", "index"}, "The history entry to solve (the focused one by default).", "index");
+	QCommandLineOption memoryOption({"m", "memory"}, "The size of the solver's table in MB.", "MB", "256");
+	QCommandLineOption nodesOption({"n", "nodes"}, "Stop after this many positions (0 for no limit).", "count", "0");
+	parser.addOption(indexOption);
+	parser.addOption(memoryOption);
+	parser.addOption(nodesOption);
+	parser.process(app);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	if (parser.positionalArguments().size() != 1) {
+		parser.showHelp(1);
+	}
+
+	QFile file(parser.positionalArguments().first());
+	if (!file.open(QIODevice::ReadOnly)) {
+		err << "Cannot open " << file.fileName() << "\n";
+		err.flush();
+		return 1;
+	}
+
+	GameConfig config;
+	History history;
+	QDataStream stream(&file);
+	stream >> config >> history;
+	if (stream.status() != QDataStream::Ok || history.size() == 0) {
+		err << "The save file is invalid\n";
+		err.flush();
+		return 1;
+	}
+
+	int index = history.focusedIndex().isSome() ? history.focusedIndex().get() : history.size() - 1;
+	if (parser.isSet(indexOption)) {
+		index = parser.value(indexOption).toInt();
+	}
+	if (index < 0 || index >= history.size()) {
+		err << "The index must be between 0 and " << history.size() - 1 << "\n";
+		err.flush();
+		return 1;
+	}
+
+	const Board& board = *history.boardAt(index);
+	Solver solver(size_t(qMax(parser.value(memoryOption).toInt(), 1)) << 20);
+	solver.setNodeLimit(parser.value(nodesOption).toULongLong());
+
+	QElapsedTimer timer;
+	timer.start();
+	Solver::Result result = solver.solve(board);
+	qint64 elapsed = timer.elapsed();
+
+	static const char* const outcomes[] = {"win", "loss", "unknown"};
+	static const char* const names[] = {"NW", "N", "NE", "E", "SE", "S", "SW", "W"};
+	out << "position: " << index << ", player " << (board.currentPlayer() == Player::One ? 1 : 2) 
+		<< " on move\n";
+	out << "result: " << outcomes[static_cast<int>(result.outcome)] << "\n";
+	if (!result.move.isEmpty()) {
+		out << "move:";
+		for (Direction dir : result.move) {
+			out << " " << names[dir];
+		}
+		out << "\n";
+	}
+	out << "nodes: " << result.nodeCount << "\n";
+	out << "time: " << elapsed << " ms\n";
+	out.flush();
+	return result.outcome == Solver::Outcome::Unknown ? 2 : 0;
+}
@@ -0,0 +1,77 @@
+#include "ps/engine/tablebasegenerator.hpp"
+#include "ps/models/gameconfig.hpp"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+
+using namespace ps;
+
+/**
+ * Generates the tablebase of a small board size, by default where the game finds it.
+ */
+int main(int argc, char** argv)
+{
+	QCoreApplication app(argc, argv);
+	// The same names as the game, so the default output is where the game looks for tablebases.
+	QCoreApplication::setOrganizationName("No organization");
+	QCoreApplication::setOrganizationDomain("pn347193.students.mimuw.edu.pl");
+	QCoreApplication::setApplicationName("Paper soccer");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Solves all positions of a small board and writes them as a tablebase.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("width", "The board width.");
+	parser.addPositionalArgument("height", "The board height.");
+	QCommandLineOption threadsOption({"t", "threads"}, "The number of threads.", "count",
+		QString::number(QThread::idealThreadCount()));
+	QCommandLineOption directoryOption({"d", "directory"},
+		"The work directory, an interrupted generation continues from it (tablebase-WxH by default).", "path");
+	QCommandLineOption outputOption({"o", "output"}, "The tablebase file.", "file");
+	parser.addOption(threadsOption);
+	parser.addOption(directoryOption);
+	parser.addOption(outputOption);
+	parser.process(app);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	if (parser.positionalArguments().size() != 2) {
+		parser.showHelp(1);
+	}
+
+	QSize size(parser.positionalArguments()[0].toInt(), parser.positionalArguments()[1].toInt());
+	if (size.width() < GameConfig::minSize || size.width() > GameConfig::maxSize
+		|| size.height() < GameConfig::minSize || size.height() > GameConfig::maxSize
+		|| size.width() % 2 != 0 || size.height() % 2 != 0) {
+		err << "The size must be even and between " << GameConfig::minSize << " and " 
+			<< GameConfig::maxSize << "\n";
+		err.flush();
+		return 1;
+	}
+
+	QString suffix = QStringLiteral("%1x%2").arg(size.width()).arg(size.height());
+	QString directory = parser.isSet(directoryOption) ? parser.value(directoryOption) : "tablebase-" + suffix;
+	QString output = parser.isSet(outputOption) ? parser.value(outputOption) : Tablebase::fileName(size);
+	if (!QFileInfo(output).absoluteDir().mkpath(QStringLiteral("."))) {
+		err << "Cannot create the directory of " << output << "\n";
+		err.flush();
+		return 1;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	TablebaseGenerator generator(size, directory, parser.value(threadsOption).toInt());
+	generator.setLog([&] (const QString& message) {
+		out << timer.elapsed() << " ms: " << message << "\n";
+		out.flush();
+	});
+	if (!generator.run(output)) {
+		err << generator.errorString() << "\n";
+		err.flush();
+		return 1;
+	}
+	return 0;
+}